@@ -1,11 +1,13 @@
 #include "analisador_semantico.hpp"
 
-SymbolType stringToSymbolType(const std::string& typeName) {
-    if (typeName == "integer") return SymbolType::INTEGER;
-    if (typeName == "real") return SymbolType::REAL;
-    if (typeName == "boolean") return SymbolType::BOOLEAN;
-    if (typeName == "string") return SymbolType::STRING;
-    return SymbolType::UNKNOWN;
+SymbolType tokenToSymbolType(Tipo_de_token type) {
+    switch (type) {
+        case Tipo_de_token::INTEGER: return SymbolType::INTEGER;
+        case Tipo_de_token::REAL:    return SymbolType::REAL;
+        case Tipo_de_token::BOOLEAN: return SymbolType::BOOLEAN;
+        case Tipo_de_token::STRING:  return SymbolType::STRING;
+        default:                     return SymbolType::UNKNOWN;
+    }
 }
 
 std::string symbolTypeToString(SymbolType type) {
@@ -14,171 +16,622 @@ std::string symbolTypeToString(SymbolType type) {
         case SymbolType::REAL:    return "REAL";
         case SymbolType::BOOLEAN: return "BOOLEAN";
         case SymbolType::STRING:  return "STRING";
+        case SymbolType::SET:     return "SET";
+        case SymbolType::PROCEDURE: return "PROCEDURE";
         default:                  return "UNKNOWN";
     }
 }
 
-void SemanticAnalyzer::analyze(const NodePtr& root) {
+void SemanticAnalyzer::analyze(const Node* root) {
     if (!root) return;
     try {
-        visit(root.get());
+        visit(root);
     } catch (const std::runtime_error& e) {
-        std::cerr << "Erro durante a analise semantica: " << e.what() << std::endl;
+        m_diagnostics.report(DiagCode::INTERNAL_SEMANTIC, DiagnosticEngine::NO_OFFSET, {e.what()});
     }
 }
 
-void SemanticAnalyzer::visit(const Node* node) {
-    if (!node) return;
-
-    if (auto p = dynamic_cast<const ProgramNode*>(node))       visit(p);
-    else if (auto p = dynamic_cast<const VarSectionNode*>(node)) visit(p);
-    else if (auto p = dynamic_cast<const BlockNode*>(node))      visit(p);
-    else if (auto p = dynamic_cast<const AssignNode*>(node))     visit(p);
-    else if (auto p = dynamic_cast<const IfNode*>(node))         visit(p);
-    else if (auto p = dynamic_cast<const WhileNode*>(node))      visit(p);
-    else if (auto p = dynamic_cast<const ForNode*>(node))        visit(p);
-    else if (auto p = dynamic_cast<const RepeatNode*>(node))     visit(p);
+void SemanticAnalyzer::analyze(const FlatAst& ast) {
+    if (ast.root() == FlatAst::NONE) return;
+    try {
+        walk(ast);
+    } catch (const std::runtime_error& e) {
+        m_diagnostics.report(DiagCode::INTERNAL_SEMANTIC, DiagnosticEngine::NO_OFFSET, {e.what()});
+    }
 }
 
-void SemanticAnalyzer::visit(const ProgramNode* node) {
-    if (node->vars) {
-        visit(node->vars.get());
+// ---- Verificacoes comuns ----
+
+void SemanticAnalyzer::declare(uint32_t simboloId, uint32_t offset, Tipo_de_token tipo) {
+    Symbol& simbolo = symbol(simboloId);
+    if (simbolo.declared && simbolo.scope == m_scope) {
+        m_diagnostics.report(DiagCode::REDECLARED_VARIABLE, offset, {m_simbolos.name(simboloId)});
+        return;
     }
-    if (node->mainBlock) {
-        visit(node->mainBlock.get());
+    if (m_scope > 0) m_shadowed.emplace_back(simboloId, simbolo);
+    simbolo = {true, tokenToSymbolType(tipo), offset, m_scope};
+}
+
+void SemanticAnalyzer::beginRoutine(uint32_t simboloId, uint32_t offset, bool funcao, Tipo_de_token resultado) {
+    m_routines.push_back({funcao, {}});
+    Symbol& simbolo = symbol(simboloId);
+    if (simbolo.declared) {
+        m_diagnostics.report(DiagCode::REDECLARED_VARIABLE, offset, {m_simbolos.name(simboloId)});
+    } else {
+        simbolo = {true, funcao ? tokenToSymbolType(resultado) : SymbolType::PROCEDURE, offset, 0,
+                   static_cast<uint32_t>(m_routines.size() - 1)};
     }
+    m_scope = 1;
 }
 
-void SemanticAnalyzer::visit(const VarSectionNode* node) {
-    for (const auto& entry : node->entries) {
-        const std::string& varName = entry.first.value.value_or("");
-        const std::string& typeName = entry.second.value.value_or("");
+void SemanticAnalyzer::declareParam(uint32_t simboloId, uint32_t offset, Tipo_de_token tipo) {
+    m_routines.back().params.push_back(tokenToSymbolType(tipo));
+    declare(simboloId, offset, tipo);
+}
+
+void SemanticAnalyzer::endRoutine() {
+    for (size_t i = m_shadowed.size(); i-- > 0;) symbol(m_shadowed[i].first) = m_shadowed[i].second;
+    m_shadowed.clear();
+    m_scope = 0;
+}
 
-        if (symbolTable.count(varName)) {
-            std::cerr << "Erro Semantico (linha " << entry.first.line << "): Variavel '" << varName << "' ja foi declarada." << std::endl;
-        } else {
-            symbolTable[varName] = {varName, stringToSymbolType(typeName), entry.first.line};
+SymbolType SemanticAnalyzer::callType(uint32_t simboloId, uint32_t offset, const SymbolType* args, size_t n, bool expressao) {
+    const Symbol& simbolo = symbol(simboloId);
+    if (!simbolo.declared || simbolo.routine == Symbol::NO_ROUTINE) {
+        m_diagnostics.report(DiagCode::NOT_A_ROUTINE, offset, {m_simbolos.name(simboloId)});
+        return SymbolType::UNKNOWN;
+    }
+    const Routine& rotina = m_routines[simbolo.routine];
+    if (expressao && !rotina.function) {
+        m_diagnostics.report(DiagCode::PROCEDURE_IN_EXPRESSION, offset, {m_simbolos.name(simboloId)});
+        return SymbolType::UNKNOWN;
+    }
+    const SymbolType resultado = rotina.function ? simbolo.type : SymbolType::UNKNOWN;
+    if (n != rotina.params.size()) {
+        m_diagnostics.report(DiagCode::ARG_COUNT_MISMATCH, offset,
+                             {m_simbolos.name(simboloId), std::to_string(rotina.params.size()), std::to_string(n)});
+        return resultado;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (args[i] != rotina.params[i] && args[i] != SymbolType::UNKNOWN) {
+            m_diagnostics.report(DiagCode::ARG_TYPE_MISMATCH, offset,
+                                 {std::to_string(i + 1), m_simbolos.name(simboloId), symbolTypeToString(rotina.params[i]),
+                                  symbolTypeToString(args[i])});
         }
     }
+    return resultado;
 }
 
-void SemanticAnalyzer::visit(const BlockNode* node) {
-    for (const auto& stmt : node->statements) {
-        visit(stmt.get());
+bool SemanticAnalyzer::checkAssignTarget(uint32_t simboloId, uint32_t offset) {
+    if (isForLoopControl(simboloId)) {
+        m_diagnostics.report(DiagCode::ASSIGN_TO_FOR_CONTROL, offset, {m_simbolos.name(simboloId)});
+        return false;
+    }
+    if (!symbol(simboloId).declared) {
+        m_diagnostics.report(DiagCode::UNDECLARED_VARIABLE, offset, {m_simbolos.name(simboloId)});
+        return false;
     }
+    return true;
 }
 
-void SemanticAnalyzer::visit(const AssignNode* node) {
-    const std::string& varName = node->target.value.value_or("");
-
-    if (forLoopControlVariables.count(varName)) {
-        std::cerr << "Erro Semantico (linha " << node->target.line << "): A variavel de controle do laco FOR '" << varName << "' nao pode ser modificada." << std::endl;
-        return;
+void SemanticAnalyzer::checkAssignType(uint32_t simboloId, uint32_t offset, SymbolType exprType) {
+    SymbolType varType = symbol(simboloId).type;
+    if (varType != exprType && exprType != SymbolType::UNKNOWN) {
+        m_diagnostics.report(DiagCode::ASSIGN_TYPE_MISMATCH, offset,
+                             {m_simbolos.name(simboloId), symbolTypeToString(varType), symbolTypeToString(exprType)});
     }
+}
 
-    if (symbolTable.find(varName) == symbolTable.end()) {
-        std::cerr << "Erro Semantico (linha " << node->target.line << "): Variavel '" << varName << "' nao foi declarada." << std::endl;
-        return;
+void SemanticAnalyzer::checkCondition(SymbolType tipo, DiagCode code) {
+    if (tipo != SymbolType::BOOLEAN && tipo != SymbolType::UNKNOWN) {
+        m_diagnostics.report(code, DiagnosticEngine::NO_OFFSET);
     }
+}
 
-    SymbolType varType = symbolTable.at(varName).type;
-    SymbolType exprType = getExpressionType(node->value.get());
+void SemanticAnalyzer::checkForControl(uint32_t simboloId, uint32_t offset) {
+    const Symbol& simbolo = symbol(simboloId);
+    if (!simbolo.declared) {
+        m_diagnostics.report(DiagCode::FOR_UNDECLARED_CONTROL, offset, {m_simbolos.name(simboloId)});
+    } else if (simbolo.type != SymbolType::INTEGER) {
+        m_diagnostics.report(DiagCode::FOR_CONTROL_NOT_INTEGER, offset, {m_simbolos.name(simboloId)});
+    }
+}
 
-    if (varType != exprType && exprType != SymbolType::UNKNOWN) {
-        std::cerr << "Erro Semantico (linha " << node->target.line << "): Incompatibilidade de tipos. Variavel '" << varName 
-                  << "' e do tipo " << symbolTypeToString(varType) << " mas recebeu uma expressao do tipo " << symbolTypeToString(exprType) << "." << std::endl;
+void SemanticAnalyzer::checkForBound(SymbolType tipo, DiagCode code, uint32_t offset) {
+    if (tipo != SymbolType::INTEGER) {
+        m_diagnostics.report(code, offset);
     }
 }
 
-void SemanticAnalyzer::visit(const IfNode* node) {
-    SymbolType conditionType = getExpressionType(node->cond.get());
-    if (conditionType != SymbolType::BOOLEAN && conditionType != SymbolType::UNKNOWN) {
-        std::cerr << "Erro Semantico: A condicao do 'if' deve ser do tipo BOOLEAN." << std::endl;
+SymbolType SemanticAnalyzer::literalType(Tipo_de_token tipo) const {
+    switch (tipo) {
+        case Tipo_de_token::INT_LIT:    return SymbolType::INTEGER;
+        case Tipo_de_token::REAL_LIT:   return SymbolType::REAL;
+        case Tipo_de_token::STRING_LIT: return SymbolType::STRING;
+        case Tipo_de_token::BOOL_LIT:   return SymbolType::BOOLEAN;
+        default:                        return SymbolType::UNKNOWN;
     }
-    visit(node->thenBr.get());
-    if (node->elseBr) {
-        visit(node->elseBr.get());
+}
+
+SymbolType SemanticAnalyzer::identifierType(uint32_t simboloId, uint32_t offset) {
+    const Symbol& simbolo = symbol(simboloId);
+    if (simbolo.declared) {
+        return simbolo.type;
     }
+    m_diagnostics.report(DiagCode::USED_UNDECLARED, offset, {m_simbolos.name(simboloId)});
+    return SymbolType::UNKNOWN;
 }
 
-void SemanticAnalyzer::visit(const WhileNode* node) {
-    SymbolType conditionType = getExpressionType(node->cond.get());
-    if (conditionType != SymbolType::BOOLEAN && conditionType != SymbolType::UNKNOWN) {
-         std::cerr << "Erro Semantico: A condicao do 'while' deve ser do tipo BOOLEAN." << std::endl;
+SymbolType SemanticAnalyzer::binaryType(Tipo_de_token op, uint32_t offset, uint32_t tamanho, SymbolType leftType, SymbolType rightType) {
+    switch (op) {
+        case Tipo_de_token::EQUAL: case Tipo_de_token::NOT_EQUAL:
+        case Tipo_de_token::LESS: case Tipo_de_token::GREATER:
+        case Tipo_de_token::LESS_EQUAL: case Tipo_de_token::GREATER_EQUAL:
+            if (leftType == rightType && leftType != SymbolType::UNKNOWN) return SymbolType::BOOLEAN;
+            break;
+        case Tipo_de_token::IN:
+            if (leftType == SymbolType::INTEGER && rightType == SymbolType::SET) return SymbolType::BOOLEAN;
+            break;
+        // Logicos sobre BOOLEAN, bit a bit sobre INTEGER
+        case Tipo_de_token::AND: case Tipo_de_token::OR:
+            if (leftType == rightType && (leftType == SymbolType::BOOLEAN || leftType == SymbolType::INTEGER)) return leftType;
+            break;
+        case Tipo_de_token::DIV: case Tipo_de_token::MOD:
+            if (leftType == SymbolType::INTEGER && rightType == SymbolType::INTEGER) return SymbolType::INTEGER;
+            break;
+        default:
+            if (leftType == rightType && (leftType == SymbolType::INTEGER || leftType == SymbolType::REAL)) return leftType;
+            break;
     }
-    visit(node->body.get());
+
+    m_diagnostics.report(DiagCode::OPERATOR_TYPE_MISMATCH, offset, {m_fontes.spelling(offset, tamanho)});
+    return SymbolType::UNKNOWN;
 }
 
-void SemanticAnalyzer::visit(const ForNode* node) {
-    const std::string& varName = node->var.value.value_or("");
+SymbolType SemanticAnalyzer::unaryType(Tipo_de_token op, uint32_t offset, uint32_t tamanho, SymbolType operando) {
+    if (op == Tipo_de_token::NOT) {
+        if (operando == SymbolType::BOOLEAN || operando == SymbolType::INTEGER) return operando;
+    } else if (operando == SymbolType::INTEGER || operando == SymbolType::REAL) {
+        return operando;
+    }
+
+    m_diagnostics.report(DiagCode::OPERATOR_TYPE_MISMATCH, offset, {m_fontes.spelling(offset, tamanho)});
+    return SymbolType::UNKNOWN;
+}
 
-    if (!symbolTable.count(varName)) {
-        std::cerr << "Erro Semantico (linha " << node->var.line << "): Variavel de controle do FOR '" << varName << "' nao foi declarada." << std::endl;
-    } else {
-        if (symbolTable.at(varName).type != SymbolType::INTEGER) {
-            std::cerr << "Erro Semantico (linha " << node->var.line << "): Variavel de controle do FOR '" << varName << "' deve ser do tipo INTEGER." << std::endl;
+SymbolType SemanticAnalyzer::setType(uint32_t offset, const SymbolType* elementos, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (elementos[i] != SymbolType::INTEGER && elementos[i] != SymbolType::UNKNOWN) {
+            m_diagnostics.report(DiagCode::SET_ELEMENT_NOT_INTEGER, offset, {symbolTypeToString(elementos[i])});
+            break; // continua sendo um conjunto: o erro nao se repete no operador
         }
     }
-    
-    if (getExpressionType(node->start.get()) != SymbolType::INTEGER) {
-        std::cerr << "Erro Semantico (linha " << node->var.line << "): A expressao inicial do FOR deve ser do tipo INTEGER." << std::endl;
-    }
-    if (getExpressionType(node->end.get()) != SymbolType::INTEGER) {
-        std::cerr << "Erro Semantico (linha " << node->var.line << "): A expressao final do FOR deve ser do tipo INTEGER." << std::endl;
-    }
+    return SymbolType::SET;
+}
 
-    forLoopControlVariables.insert(varName);
-    visit(node->body.get());
-    forLoopControlVariables.erase(varName);
+// ---- AST de ponteiros ----
+
+void SemanticAnalyzer::visit(const Node* root) {
+    // Pilha de trabalho em vez de recursao, como em walk(): a profundidade da
+    // arvore nao consome a pilha nativa. 'depois' marca a segunda visita (fim
+    // do FOR, condicao do REPEAT).
+    struct Item {
+        const Node* node;
+        bool depois;
+    };
+    std::vector<Item> pilha {{root, false}};
+
+    // Atribuicoes nao tem comandos filhos e sao verificadas na hora; a partir do
+    // primeiro comando composto o resto da lista vai para a pilha, na ordem.
+    auto comandos = [this, &pilha](const ArenaSpan<const StmtPtr>& lista) {
+        size_t i = 0;
+        for (; i < lista.size() && lista[i]->kind == AstKind::ASSIGN; i++) {
+            checkAssign(static_cast<const AssignNode*>(lista[i]));
+        }
+        for (size_t j = lista.size(); j-- > i;) pilha.push_back({lista[j], false});
+    };
+
+    while (!pilha.empty()) {
+        const Item item = pilha.back();
+        pilha.pop_back();
+        const Node* node = item.node;
+        if (!node) continue;
+
+        switch (node->kind) {
+            case AstKind::PROGRAM: {
+                auto p = static_cast<const ProgramNode*>(node);
+                pilha.push_back({p->mainBlock, false});
+                for (size_t i = p->routines.size(); i-- > 0;) pilha.push_back({p->routines[i], false});
+                pilha.push_back({p->vars, false});
+                break;
+            }
+            case AstKind::ROUTINE: {
+                auto p = static_cast<const FunctionDeclNode*>(node);
+                if (item.depois) {
+                    endRoutine();
+                    break;
+                }
+                beginRoutine(p->name.symbol(), p->name.offset, p->isFunction, p->resultType.type);
+                for (const ParamEntry& param : p->params) declareParam(param.name.symbol(), param.name.offset, param.type.type);
+                pilha.push_back({node, true});
+                pilha.push_back({p->body, false});
+                pilha.push_back({p->vars, false});
+                break;
+            }
+            case AstKind::PROC_CALL: {
+                auto p = static_cast<const ProcCallNode*>(node);
+                m_argTypes.clear();
+                for (const ExprNode* arg : p->args) m_argTypes.push_back(getExpressionType(arg));
+                callType(p->name.symbol(), p->name.offset, m_argTypes.data(), m_argTypes.size(), false);
+                break;
+            }
+            case AstKind::VAR_SECTION:
+                for (const auto& entry : static_cast<const VarSectionNode*>(node)->entries) {
+                    declare(entry.name.symbol(), entry.name.offset, entry.type.type);
+                }
+                break;
+            case AstKind::BLOCK:
+                comandos(static_cast<const BlockNode*>(node)->statements);
+                break;
+            case AstKind::ASSIGN:
+                checkAssign(static_cast<const AssignNode*>(node));
+                break;
+            case AstKind::IF: {
+                auto p = static_cast<const IfNode*>(node);
+                checkCondition(getExpressionType(p->cond), DiagCode::IF_NOT_BOOLEAN);
+                pilha.push_back({p->elseBr, false});
+                pilha.push_back({p->thenBr, false});
+                break;
+            }
+            case AstKind::WHILE: {
+                auto p = static_cast<const WhileNode*>(node);
+                checkCondition(getExpressionType(p->cond), DiagCode::WHILE_NOT_BOOLEAN);
+                pilha.push_back({p->body, false});
+                break;
+            }
+            case AstKind::FOR: {
+                auto p = static_cast<const ForNode*>(node);
+                if (item.depois) {
+                    setForLoopControl(p->var.symbol(), false);
+                    break;
+                }
+                checkForControl(p->var.symbol(), p->var.offset);
+                checkForBound(getExpressionType(p->start), DiagCode::FOR_START_NOT_INTEGER, p->var.offset);
+                checkForBound(getExpressionType(p->end), DiagCode::FOR_END_NOT_INTEGER, p->var.offset);
+                setForLoopControl(p->var.symbol(), true);
+                pilha.push_back({node, true});
+                pilha.push_back({p->body, false});
+                break;
+            }
+            case AstKind::REPEAT: {
+                auto p = static_cast<const RepeatNode*>(node);
+                if (item.depois) {
+                    checkCondition(getExpressionType(p->cond), DiagCode::UNTIL_NOT_BOOLEAN);
+                    break;
+                }
+                pilha.push_back({node, true});
+                comandos(p->body);
+                break;
+            }
+            default:
+                break;
+        }
+    }
 }
 
-void SemanticAnalyzer::visit(const RepeatNode* node) {
-    for (const auto& stmt : node->body) {
-        visit(stmt.get());
+void SemanticAnalyzer::checkAssign(const AssignNode* node) {
+    if (checkAssignTarget(node->target.symbol(), node->target.offset)) {
+        checkAssignType(node->target.symbol(), node->target.offset, getExpressionType(node->value));
     }
-    SymbolType conditionType = getExpressionType(node->cond.get());
-    if (conditionType != SymbolType::BOOLEAN && conditionType != SymbolType::UNKNOWN) {
-        std::cerr << "Erro Semantico: A condicao do 'until' deve ser do tipo BOOLEAN." << std::endl;
+}
+
+bool SemanticAnalyzer::leafType(const ExprNode* expr, SymbolType& tipo) {
+    switch (expr->kind) {
+        case AstKind::LITERAL:
+            tipo = literalType(static_cast<const LiteralNode*>(expr)->value.type);
+            return true;
+        case AstKind::IDENTIFIER: {
+            const Token& id = static_cast<const IdentifierNode*>(expr)->identifier;
+            tipo = identifierType(id.symbol(), id.offset);
+            return true;
+        }
+        default:
+            return false;
     }
 }
 
 SymbolType SemanticAnalyzer::getExpressionType(const ExprNode* expr) {
     if (!expr) return SymbolType::UNKNOWN;
+    SymbolType tipo;
+    if (leafType(expr, tipo)) return tipo;
 
-    if (auto lit = dynamic_cast<const LiteralNode*>(expr)) {
-        switch (lit->value.type) {
-            case Tipo_de_token::INT_LIT:    return SymbolType::INTEGER;
-            case Tipo_de_token::REAL_LIT:   return SymbolType::REAL;
-            case Tipo_de_token::STRING_LIT: return SymbolType::STRING;
-            case Tipo_de_token::BOOL_LIT:   return SymbolType::BOOLEAN;
-            default:                    return SymbolType::UNKNOWN;
+    // Pos-ordem com pilha explicita (cadeias como 1+1+1+... tem a profundidade
+    // do numero de termos). O operador fica na pilha enquanto os operandos sao
+    // avaliados, com 'etapa' indicando quantos ja terminaram; os tipos prontos
+    // ficam no topo de m_exprTypes. O caminho mais a esquerda e seguido sem
+    // empilhar e operandos folha sao avaliados na hora, entao as expressoes
+    // comuns quase nao usam a pilha. Os diagnosticos saem na mesma ordem da
+    // avaliacao recursiva.
+    std::vector<ExprFrame>& pilha = m_exprStack;
+    std::vector<SymbolType>& tipos = m_exprTypes;
+    pilha.clear();
+    tipos.clear();
+
+    ExprFrame f {expr, 0};
+    for (;;) {
+        const ExprNode* node = f.node;
+        switch (node->kind) {
+            case AstKind::BINARY_OP: {
+                auto p = static_cast<const BinaryOpNode*>(node);
+                if (f.etapa == 0) {
+                    pilha.push_back({node, 1});
+                    f = {p->left, 0};
+                    continue;
+                }
+                if (f.etapa == 1) {
+                    if (!leafType(p->right, tipo)) {
+                        pilha.push_back({node, 2});
+                        f = {p->right, 0};
+                        continue;
+                    }
+                } else {
+                    tipo = tipos.back();
+                    tipos.pop_back();
+                }
+                tipos.back() = binaryType(p->op.type, p->op.offset, p->op.length, tipos.back(), tipo);
+                break;
+            }
+            case AstKind::UNARY_OP: {
+                auto p = static_cast<const UnaryOpNode*>(node);
+                if (f.etapa == 0) {
+                    pilha.push_back({node, 1});
+                    f = {p->operand, 0};
+                    continue;
+                }
+                tipos.back() = unaryType(p->op.type, p->op.offset, p->op.length, tipos.back());
+                break;
+            }
+            case AstKind::SET: {
+                // Os elementos sao empilhados de uma vez; 'etapa' so marca a volta
+                auto p = static_cast<const SetNode*>(node);
+                const size_t n = p->elements.size();
+                if (f.etapa == 0 && n > 0) {
+                    pilha.push_back({node, 1});
+                    for (size_t i = n; i-- > 1;) pilha.push_back({p->elements[i], 0});
+                    f = {p->elements[0], 0};
+                    continue;
+                }
+                tipo = setType(p->open.offset, tipos.data() + tipos.size() - n, n);
+                tipos.resize(tipos.size() - n);
+                tipos.push_back(tipo);
+                break;
+            }
+            case AstKind::FUNC_CALL: {
+                // Como no conjunto: os argumentos primeiro, depois a chamada
+                auto p = static_cast<const FuncCallNode*>(node);
+                const size_t n = p->args.size();
+                if (f.etapa == 0 && n > 0) {
+                    pilha.push_back({node, 1});
+                    for (size_t i = n; i-- > 1;) pilha.push_back({p->args[i], 0});
+                    f = {p->args[0], 0};
+                    continue;
+                }
+                tipo = callType(p->name.symbol(), p->name.offset, tipos.data() + tipos.size() - n, n, true);
+                tipos.resize(tipos.size() - n);
+                tipos.push_back(tipo);
+                break;
+            }
+            default:
+                if (!leafType(node, tipo)) tipo = SymbolType::UNKNOWN;
+                tipos.push_back(tipo);
+                break;
         }
+        if (pilha.empty()) break;
+        f = pilha.back();
+        pilha.pop_back();
+    }
+    return tipos.back();
+}
+
+// ---- Passagem unica ----
+
+OnePassChecker::Stmt OnePassChecker::varSection(const VarEntry* entradas, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        m_analisador.declare(entradas[i].name.symbol(), entradas[i].name.offset, entradas[i].type.type);
+    }
+    return {};
+}
+
+void OnePassChecker::beginAssign(const Token& target) {
+    m_ignorar = !m_analisador.checkAssignTarget(target.symbol(), target.offset);
+}
+
+OnePassChecker::Stmt OnePassChecker::assign(const Token& target, Expr value) {
+    if (!m_ignorar) m_analisador.checkAssignType(target.symbol(), target.offset, value);
+    m_ignorar = false;
+    return {};
+}
+
+SymbolType OnePassChecker::ifCondition(Expr cond) {
+    m_analisador.checkCondition(cond, DiagCode::IF_NOT_BOOLEAN);
+    return cond;
+}
+
+SymbolType OnePassChecker::whileCondition(Expr cond) {
+    m_analisador.checkCondition(cond, DiagCode::WHILE_NOT_BOOLEAN);
+    return cond;
+}
+
+void OnePassChecker::forControl(const Token& var) {
+    m_analisador.checkForControl(var.symbol(), var.offset);
+}
+
+SymbolType OnePassChecker::forStart(const Token& var, Expr start) {
+    m_analisador.checkForBound(start, DiagCode::FOR_START_NOT_INTEGER, var.offset);
+    return start;
+}
+
+// O corpo vem a seguir: a variavel de controle fica protegida ate forStmt()
+SymbolType OnePassChecker::forEnd(const Token& var, Expr end) {
+    m_analisador.checkForBound(end, DiagCode::FOR_END_NOT_INTEGER, var.offset);
+    m_analisador.setForLoopControl(var.symbol(), true);
+    return end;
+}
+
+OnePassChecker::Stmt OnePassChecker::forStmt(const Token& var, Expr, Expr, bool, Stmt) {
+    m_analisador.setForLoopControl(var.symbol(), false);
+    return {};
+}
+
+OnePassChecker::Stmt OnePassChecker::repeatStmt(const Stmt*, size_t, Expr cond) {
+    m_analisador.checkCondition(cond, DiagCode::UNTIL_NOT_BOOLEAN);
+    return {};
+}
+
+OnePassChecker::Stmt OnePassChecker::procCall(const Token& name, const Expr* args, size_t n) {
+    m_analisador.callType(name.symbol(), name.offset, args, n, false);
+    return {};
+}
+
+// Chamado antes das variaveis locais e do corpo: os parametros ja ficam visiveis
+void OnePassChecker::beginRoutine(const RoutineHeader& h) {
+    m_analisador.beginRoutine(h.name.symbol(), h.name.offset, h.isFunction, h.resultType.type);
+    for (size_t i = 0; i < h.paramCount; i++) {
+        m_analisador.declareParam(h.params[i].name.symbol(), h.params[i].name.offset, h.params[i].type.type);
     }
-    if (auto var = dynamic_cast<const IdentifierNode*>(expr)) {
-        const std::string& varName = var->identifier.value.value_or("");
-        if (symbolTable.count(varName)) {
-            return symbolTable.at(varName).type;
+}
+
+OnePassChecker::Stmt OnePassChecker::routine(const RoutineHeader&, Stmt, Stmt) {
+    m_analisador.endRoutine();
+    return {};
+}
+
+// ---- AST plana ----
+
+void SemanticAnalyzer::walk(const FlatAst& ast) {
+    // Pilha de trabalho em vez de recursao. 'depois' marca a segunda visita dos
+    // nos que tem algo a fazer apos os filhos (fim do FOR, condicao do REPEAT).
+    struct Item {
+        uint32_t node;
+        bool depois;
+    };
+    std::vector<Item> pilha {{ast.root(), false}};
+
+    while (!pilha.empty()) {
+        const Item item = pilha.back();
+        pilha.pop_back();
+        if (item.node == FlatAst::NONE) continue;
+        const FlatNode& n = ast[item.node];
+
+        switch (n.kind) {
+            case AstKind::PROGRAM: {
+                // rhs: [bloco principal, n, rotinas...]
+                FlatAst::List rotinas = ast.list(n.rhs + 1);
+                pilha.push_back({ast.extra(n.rhs), false});
+                for (uint32_t i = rotinas.count; i-- > 0;) pilha.push_back({rotinas.first[i], false});
+                pilha.push_back({n.lhs, false});
+                break;
+            }
+            case AstKind::ROUTINE: {
+                // rhs: [variaveis, corpo, n, parametros...]
+                if (item.depois) {
+                    endRoutine();
+                    break;
+                }
+                beginRoutine(n.lhs, n.offset, n.aux != 0, n.token);
+                for (uint32_t d : ast.list(n.rhs + 2)) declareParam(ast[d].lhs, ast[d].offset, ast[d].token);
+                pilha.push_back({item.node, true});
+                pilha.push_back({ast.extra(n.rhs + 1), false});
+                pilha.push_back({ast.extra(n.rhs), false});
+                break;
+            }
+            case AstKind::PROC_CALL:
+                m_argTypes.clear();
+                for (uint32_t arg : ast.list(n.rhs)) m_argTypes.push_back(expressionType(ast, arg));
+                callType(n.lhs, n.offset, m_argTypes.data(), m_argTypes.size(), false);
+                break;
+            case AstKind::VAR_SECTION:
+                for (uint32_t d : ast.list(n.lhs)) declare(ast[d].lhs, ast[d].offset, ast[d].token);
+                break;
+            case AstKind::BLOCK: {
+                FlatAst::List comandos = ast.list(n.lhs);
+                for (uint32_t i = comandos.count; i-- > 0;) pilha.push_back({comandos.first[i], false});
+                break;
+            }
+            case AstKind::ASSIGN:
+                if (checkAssignTarget(n.lhs, n.offset)) checkAssignType(n.lhs, n.offset, expressionType(ast, n.rhs));
+                break;
+            case AstKind::IF:
+                checkCondition(expressionType(ast, n.lhs), DiagCode::IF_NOT_BOOLEAN);
+                pilha.push_back({ast.extra(n.rhs + 1), false});
+                pilha.push_back({ast.extra(n.rhs), false});
+                break;
+            case AstKind::WHILE:
+                checkCondition(expressionType(ast, n.lhs), DiagCode::WHILE_NOT_BOOLEAN);
+                pilha.push_back({n.rhs, false});
+                break;
+            case AstKind::FOR:
+                if (item.depois) {
+                    setForLoopControl(n.lhs, false);
+                    break;
+                }
+                checkForControl(n.lhs, n.offset);
+                checkForBound(expressionType(ast, ast.extra(n.rhs)), DiagCode::FOR_START_NOT_INTEGER, n.offset);
+                checkForBound(expressionType(ast, ast.extra(n.rhs + 1)), DiagCode::FOR_END_NOT_INTEGER, n.offset);
+                setForLoopControl(n.lhs, true);
+                pilha.push_back({item.node, true});
+                pilha.push_back({ast.extra(n.rhs + 2), false});
+                break;
+            case AstKind::REPEAT: {
+                if (item.depois) {
+                    checkCondition(expressionType(ast, n.rhs), DiagCode::UNTIL_NOT_BOOLEAN);
+                    break;
+                }
+                pilha.push_back({item.node, true});
+                FlatAst::List comandos = ast.list(n.lhs);
+                for (uint32_t i = comandos.count; i-- > 0;) pilha.push_back({comandos.first[i], false});
+                break;
+            }
+            default:
+                break;
         }
-        std::cerr << "Erro Semantico (linha " << var->identifier.line << "): Variavel '" << varName << "' usada sem ser declarada." << std::endl;
-        return SymbolType::UNKNOWN;
     }
-    if (auto binOp = dynamic_cast<const BinaryOpNode*>(expr)) {
-        SymbolType leftType = getExpressionType(binOp->left.get());
-        SymbolType rightType = getExpressionType(binOp->right.get());
+}
+
+SymbolType SemanticAnalyzer::expressionType(const FlatAst& ast, uint32_t raiz) {
+    if (raiz == FlatAst::NONE) return SymbolType::UNKNOWN;
 
-        if (binOp->op.type == Tipo_de_token::EQUAL || binOp->op.type == Tipo_de_token::NOT_EQUAL ||
-            binOp->op.type == Tipo_de_token::LESS || binOp->op.type == Tipo_de_token::GREATER ||
-            binOp->op.type == Tipo_de_token::LESS_EQUAL || binOp->op.type == Tipo_de_token::GREATER_EQUAL) {
-            if (leftType == rightType && leftType != SymbolType::UNKNOWN) {
-                return SymbolType::BOOLEAN;
+    // Em pos-ordem os filhos vem antes do pai e a esquerda antes da direita, entao
+    // uma passada linear pelo intervalo reproduz a ordem dos diagnosticos da
+    // avaliacao recursiva.
+    const uint32_t inicio = ast.exprBegin(raiz);
+    m_exprTypes.resize(raiz - inicio + 1);
+    for (uint32_t i = inicio; i <= raiz; i++) {
+        const FlatNode& n = ast[i];
+        SymbolType& tipo = m_exprTypes[i - inicio];
+        switch (n.kind) {
+            case AstKind::LITERAL:    tipo = literalType(n.token); break;
+            case AstKind::IDENTIFIER: tipo = identifierType(n.lhs, n.offset); break;
+            case AstKind::BINARY_OP:
+                tipo = binaryType(n.token, n.offset, n.aux, m_exprTypes[n.lhs - inicio], m_exprTypes[n.rhs - inicio]);
+                break;
+            case AstKind::UNARY_OP:
+                tipo = unaryType(n.token, n.offset, n.aux, m_exprTypes[n.lhs - inicio]);
+                break;
+            case AstKind::SET: {
+                m_setTypes.clear();
+                for (uint32_t e : ast.list(n.lhs)) m_setTypes.push_back(m_exprTypes[e - inicio]);
+                tipo = setType(n.offset, m_setTypes.data(), m_setTypes.size());
+                break;
+            }
+            case AstKind::FUNC_CALL: {
+                m_setTypes.clear();
+                for (uint32_t a : ast.list(n.rhs)) m_setTypes.push_back(m_exprTypes[a - inicio]);
+                tipo = callType(n.lhs, n.offset, m_setTypes.data(), m_setTypes.size(), true);
+                break;
             }
-        } else if (leftType == rightType && (leftType == SymbolType::INTEGER || leftType == SymbolType::REAL)) {
-            return leftType;
+            default:                  tipo = SymbolType::UNKNOWN; break;
         }
-        
-        std::cerr << "Erro Semantico (linha " << binOp->op.line << "): Tipos incompativeis para o operador '" << binOp->op.value.value_or("") << "'." << std::endl;
-        return SymbolType::UNKNOWN;
     }
-    
-    return SymbolType::UNKNOWN;
-}
\ No newline at end of file
+    return m_exprTypes[raiz - inicio];
+}
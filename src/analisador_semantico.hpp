@@ -2,42 +2,165 @@
 #define ANALISADOR_SEMANTICO_HPP
 
 #include "parser.hpp" 
+#include "flat_ast.hpp"
 #include <string>
+#include <string_view>
 #include <vector>
-#include <unordered_map>
-#include <unordered_set>
 #include <iostream>
 #include <stdexcept>
 
 enum class SymbolType {
-    UNKNOWN, INTEGER, REAL, BOOLEAN, STRING, PROCEDURE
+    UNKNOWN, INTEGER, REAL, BOOLEAN, STRING, SET, PROCEDURE
 };
 
 struct Symbol {
-    std::string name;
-    SymbolType type;
-    int line;
+    static constexpr uint32_t NO_ROUTINE = UINT32_MAX;
+
+    bool declared = false;
+    SymbolType type = SymbolType::UNKNOWN; // em funcoes, o tipo do resultado
+    uint32_t offset = 0; // posicao da declaracao
+    uint32_t scope = 0;  // 0 = global, 1 = dentro de uma rotina
+    uint32_t routine = NO_ROUTINE; // indice da assinatura, se o simbolo e uma rotina
+};
+
+// Assinatura de um procedimento ou funcao
+struct Routine {
+    bool function = false;
+    std::vector<SymbolType> params;
 };
 
+class OnePassChecker;
+
 class SemanticAnalyzer {
 public:
-    void analyze(const NodePtr& root);
+    // O texto dos tokens da AST e lido pelas posicoes globais do SourceManager do
+    // DiagnosticEngine; os nomes sao resolvidos pelos IDs que o lexico registrou em 'simbolos'.
+    SemanticAnalyzer(const Interner& simbolos, DiagnosticEngine& diagnosticos)
+        : m_fontes(diagnosticos.sources()), m_simbolos(simbolos), m_diagnostics(diagnosticos) {}
+
+    void analyze(const Node* root);
+    // Mesma analise sobre a AST plana, com os mesmos diagnosticos e na mesma ordem
+    void analyze(const FlatAst& ast);
 
 private:
-    std::unordered_map<std::string, Symbol> symbolTable;
-    std::unordered_set<std::string> forLoopControlVariables;
-
-    void visit(const Node* node);
-    void visit(const ProgramNode* node);
-    void visit(const VarSectionNode* node);
-    void visit(const BlockNode* node);
-    void visit(const AssignNode* node);
-    void visit(const IfNode* node);
-    void visit(const WhileNode* node);
-    void visit(const ForNode* node);
-    void visit(const RepeatNode* node);
+    friend class OnePassChecker;
 
+    const SourceManager& m_fontes;
+    const Interner& m_simbolos;
+    DiagnosticEngine& m_diagnostics;
+    // Indexados pelo ID do simbolo
+    std::vector<Symbol> symbolTable;
+    std::vector<bool> forLoopControlVariables;
+    std::vector<Routine> m_routines;
+    // Escopo da rotina em analise: cada declaracao local guarda o simbolo que
+    // ela encobriu, restaurado no fim da rotina
+    uint32_t m_scope = 0;
+    std::vector<std::pair<uint32_t, Symbol>> m_shadowed;
+
+    Symbol& symbol(uint32_t id) {
+        if (id >= symbolTable.size()) symbolTable.resize(m_simbolos.size() > id ? m_simbolos.size() : id + 1);
+        return symbolTable[id];
+    }
+    bool isForLoopControl(uint32_t id) const { return id < forLoopControlVariables.size() && forLoopControlVariables[id]; }
+    void setForLoopControl(uint32_t id, bool ativo) {
+        if (id >= forLoopControlVariables.size()) forLoopControlVariables.resize(m_simbolos.size() > id ? m_simbolos.size() : id + 1);
+        forLoopControlVariables[id] = ativo;
+    }
+
+    // Verificacoes comuns as duas representacoes da AST
+    void declare(uint32_t simbolo, uint32_t offset, Tipo_de_token tipo);
+    // Declara a rotina e abre o escopo dela; os parametros vem em seguida, em ordem
+    void beginRoutine(uint32_t simbolo, uint32_t offset, bool funcao, Tipo_de_token resultado);
+    void declareParam(uint32_t simbolo, uint32_t offset, Tipo_de_token tipo);
+    void endRoutine();
+    // Tipo do resultado (UNKNOWN para procedimentos); 'expressao' para chamadas dentro de expressoes
+    SymbolType callType(uint32_t simbolo, uint32_t offset, const SymbolType* args, size_t n, bool expressao);
+    // false se a atribuicao ja foi rejeitada (o valor nao e avaliado)
+    bool checkAssignTarget(uint32_t simbolo, uint32_t offset);
+    void checkAssignType(uint32_t simbolo, uint32_t offset, SymbolType exprType);
+    void checkCondition(SymbolType tipo, DiagCode code);
+    void checkForControl(uint32_t simbolo, uint32_t offset);
+    void checkForBound(SymbolType tipo, DiagCode code, uint32_t offset);
+    SymbolType literalType(Tipo_de_token tipo) const;
+    SymbolType identifierType(uint32_t simbolo, uint32_t offset);
+    SymbolType binaryType(Tipo_de_token op, uint32_t offset, uint32_t tamanho, SymbolType esquerda, SymbolType direita);
+    SymbolType unaryType(Tipo_de_token op, uint32_t offset, uint32_t tamanho, SymbolType operando);
+    // 'elementos' sao os tipos dos elementos, na ordem do fonte
+    SymbolType setType(uint32_t offset, const SymbolType* elementos, size_t n);
+
+    // AST de ponteiros (sem recursao: a profundidade da arvore nao usa a pilha nativa)
+    void visit(const Node* root);
+    void checkAssign(const AssignNode* node);
     SymbolType getExpressionType(const ExprNode* expr);
+    // Tipo de um literal ou identificador; false se 'expr' nao e folha
+    bool leafType(const ExprNode* expr, SymbolType& tipo);
+    struct ExprFrame {
+        const ExprNode* node;
+        uint8_t etapa; // operandos ja avaliados
+    };
+    std::vector<ExprFrame> m_exprStack;
+
+    // AST plana
+    void walk(const FlatAst& ast);
+    SymbolType expressionType(const FlatAst& ast, uint32_t raiz);
+    std::vector<SymbolType> m_exprTypes; // tipos das subexpressoes em avaliacao (as duas ASTs)
+    std::vector<SymbolType> m_setTypes;  // tipos dos elementos do conjunto (ou argumentos da funcao) em avaliacao
+    std::vector<SymbolType> m_argTypes;  // tipos dos argumentos de uma chamada de procedimento (as duas ASTs)
+};
+
+// Acoes do parser para a compilacao em passagem unica (BasicParser<OnePassChecker>):
+// nenhuma AST e montada. Cada construcao e verificada assim que o parser a
+// reconhece, com as verificacoes da SemanticAnalyzer e na mesma ordem da
+// analise sobre a AST; o valor de uma expressao e o seu tipo. A diferenca e que
+// os erros semanticos anteriores a um erro sintatico tambem sao emitidos.
+class OnePassChecker {
+public:
+    using Expr = SymbolType;
+    struct Stmt {};
+    using Program = bool; // false se houve erro sintatico
+
+    explicit OnePassChecker(SemanticAnalyzer& analisador) : m_analisador(analisador) {}
+
+    Expr literal(const Token& t) { return m_analisador.literalType(t.type); }
+    Expr identifier(const Token& t) {
+        return m_ignorar ? SymbolType::UNKNOWN : m_analisador.identifierType(t.symbol(), t.offset);
+    }
+    Expr unary(const Token& op, Expr operand) {
+        return m_ignorar ? SymbolType::UNKNOWN : m_analisador.unaryType(op.type, op.offset, op.length, operand);
+    }
+    Expr binary(Expr left, const Token& op, Expr right) {
+        return m_ignorar ? SymbolType::UNKNOWN : m_analisador.binaryType(op.type, op.offset, op.length, left, right);
+    }
+    Expr set(const Token& open, const Expr* elementos, size_t n) {
+        return m_ignorar ? SymbolType::UNKNOWN : m_analisador.setType(open.offset, elementos, n);
+    }
+    Expr funcCall(const Token& name, const Expr* args, size_t n) {
+        return m_ignorar ? SymbolType::UNKNOWN : m_analisador.callType(name.symbol(), name.offset, args, n, true);
+    }
+
+    Stmt varSection(const VarEntry* entradas, size_t n);
+    Stmt block(const Stmt*, size_t) { return {}; }
+    void beginAssign(const Token& target);
+    Stmt assign(const Token& target, Expr value);
+    Expr ifCondition(Expr cond);
+    Stmt ifStmt(Expr, Stmt, Stmt) { return {}; }
+    Expr whileCondition(Expr cond);
+    Stmt whileStmt(Expr, Stmt) { return {}; }
+    void forControl(const Token& var);
+    Expr forStart(const Token& var, Expr start);
+    Expr forEnd(const Token& var, Expr end);
+    Stmt forStmt(const Token& var, Expr, Expr, bool, Stmt);
+    Stmt repeatStmt(const Stmt*, size_t, Expr cond);
+    Stmt procCall(const Token& name, const Expr* args, size_t n);
+    void beginRoutine(const RoutineHeader& h);
+    Stmt routine(const RoutineHeader&, Stmt, Stmt);
+    Program program(const Token&, Stmt, const Stmt*, size_t, Stmt) { return true; }
+
+private:
+    SemanticAnalyzer& m_analisador;
+    // Valor de uma atribuicao cujo alvo foi rejeitado: como na analise sobre a
+    // AST, ele nao e avaliado (nao gera diagnosticos).
+    bool m_ignorar = false;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,62 @@
+#ifndef ASCII_FOLD_HPP
+#define ASCII_FOLD_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// Comparacao e hash sem distinguir maiusculas de minusculas, para Pascal.
+// Validos para identificadores ([A-Za-z0-9_]): nesse conjunto, ligar o bit 0x20
+// leva cada letra para a minuscula e nao junta nenhum outro par de caracteres.
+// Os bytes sao processados 8 por vez (SWAR), sem criar copias em minusculas.
+namespace fold {
+
+constexpr uint64_t BITS = 0x2020202020202020ull;
+
+// Carrega ate 8 bytes de 'p' numa palavra (bytes ausentes ficam zerados)
+inline uint64_t load(const char* p, size_t n) {
+    uint64_t w = 0;
+    std::memcpy(&w, p, n < 8 ? n : 8);
+    return w;
+}
+
+inline uint64_t mask(size_t n) {
+    return n >= 8 ? BITS : load(reinterpret_cast<const char*>(&BITS), n);
+}
+
+inline bool equals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    size_t i = 0;
+    for (; i + 8 <= a.size(); i += 8) {
+        if ((load(a.data() + i, 8) | BITS) != (load(b.data() + i, 8) | BITS)) return false;
+    }
+    size_t resto = a.size() - i;
+    return resto == 0 || (load(a.data() + i, resto) | mask(resto)) == (load(b.data() + i, resto) | mask(resto));
+}
+
+inline size_t hash(std::string_view s) {
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ s.size();
+    size_t i = 0;
+    for (; i + 8 <= s.size(); i += 8) {
+        h = (h ^ (load(s.data() + i, 8) | BITS)) * 0xFF51AFD7ED558CCDull;
+        h ^= h >> 32;
+    }
+    if (size_t resto = s.size() - i) {
+        h = (h ^ (load(s.data() + i, resto) | mask(resto))) * 0xFF51AFD7ED558CCDull;
+        h ^= h >> 32;
+    }
+    return static_cast<size_t>(h);
+}
+
+struct Hash {
+    size_t operator()(std::string_view s) const { return hash(s); }
+};
+
+struct Equal {
+    bool operator()(std::string_view a, std::string_view b) const { return equals(a, b); }
+};
+
+} // namespace fold
+
+#endif
@@ -0,0 +1,141 @@
+#ifndef AST_ARENA_HPP
+#define AST_ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Trecho contiguo de elementos guardados na AstArena (listas de comandos,
+// declaracoes). Nao possui os elementos: vale enquanto a arena existir.
+template <class T>
+class ArenaSpan {
+public:
+    ArenaSpan() = default;
+    ArenaSpan(T* dados, size_t tamanho) : m_data(dados), m_size(tamanho) {}
+
+    [[nodiscard]] T* begin() const { return m_data; }
+    [[nodiscard]] T* end() const { return m_data + m_size; }
+    [[nodiscard]] size_t size() const { return m_size; }
+    [[nodiscard]] bool empty() const { return m_size == 0; }
+    T& operator[](size_t i) const { return m_data[i]; }
+
+private:
+    T* m_data = nullptr;
+    size_t m_size = 0;
+};
+
+// Alocador de blocos (bump pointer) para os nos da AST de uma compilacao.
+// Cada no e reservado avancando um cursor dentro do bloco atual, entao nos
+// criados em sequencia ficam contiguos na memoria. Os destrutores dos nos nunca
+// sao chamados: eles nao possuem recursos (filhos sao ponteiros para a mesma
+// arena e listas sao ArenaSpan), e clear() ou o destrutor da arena liberam
+// todos os blocos de uma vez, sem percorrer a arvore.
+class AstArena {
+public:
+    AstArena() = default;
+    AstArena(const AstArena&) = delete;
+    AstArena& operator=(const AstArena&) = delete;
+
+    template <class T, class... Args>
+    T* make(Args&&... args) {
+        static_assert(std::is_trivially_destructible_v<T>, "os nos da arena nao sao destruidos individualmente");
+        m_nodes++;
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // Copia 'n' elementos para a arena (usado para fixar listas montadas numa pilha temporaria)
+    template <class T>
+    ArenaSpan<T> copy(const T* dados, size_t n) {
+        static_assert(std::is_trivially_copyable_v<T>, "ArenaSpan so guarda tipos trivialmente copiaveis");
+        if (n == 0) return {};
+        auto destino = static_cast<std::remove_const_t<T>*>(allocate(n * sizeof(T), alignof(T)));
+        std::memcpy(destino, dados, n * sizeof(T));
+        return {destino, n};
+    }
+
+    void* allocate(size_t bytes, size_t alinhamento) {
+        const uintptr_t atual = reinterpret_cast<uintptr_t>(m_cursor);
+        const uintptr_t alinhado = (atual + alinhamento - 1) & ~(uintptr_t(alinhamento) - 1);
+        if (!m_cursor || alinhado + bytes > reinterpret_cast<uintptr_t>(m_limit)) return grow(bytes, alinhamento);
+        m_cursor = reinterpret_cast<char*>(alinhado + bytes);
+        m_used += bytes;
+        return reinterpret_cast<void*>(alinhado);
+    }
+
+    // Libera todos os nos; os ponteiros devolvidos ate aqui deixam de ser validos
+    void clear() {
+        m_blocks.clear();
+        m_cursor = m_limit = nullptr;
+        m_next = FIRST_BLOCK;
+        m_nodes = m_used = m_reserved = 0;
+    }
+
+    // Passa a possuir os blocos de 'outra' (por exemplo, a arena de uma thread do
+    // ParallelParser): os nos dela continuam validos e passam a viver ate o
+    // clear() desta arena. 'outra' fica vazia.
+    void adopt(AstArena& outra) {
+        for (auto& bloco : outra.m_blocks) m_blocks.push_back(std::move(bloco));
+        m_nodes += outra.m_nodes;
+        m_used += outra.m_used;
+        m_reserved += outra.m_reserved;
+        outra.clear();
+    }
+
+    // Posicao da arena; rewind() libera tudo o que foi alocado depois dela
+    struct Mark {
+        size_t blocks;
+        char* cursor;
+        char* limit;
+        size_t next;
+        size_t nodes;
+        size_t used;
+        size_t reserved;
+    };
+    [[nodiscard]] Mark mark() const { return {m_blocks.size(), m_cursor, m_limit, m_next, m_nodes, m_used, m_reserved}; }
+    void rewind(const Mark& m) {
+        m_blocks.resize(m.blocks);
+        m_cursor = m.cursor;
+        m_limit = m.limit;
+        m_next = m.next;
+        m_nodes = m.nodes;
+        m_used = m.used;
+        m_reserved = m.reserved;
+    }
+
+    [[nodiscard]] size_t nodes() const { return m_nodes; }
+    [[nodiscard]] size_t bytesUsed() const { return m_used; }
+    [[nodiscard]] size_t bytesReserved() const { return m_reserved; }
+    [[nodiscard]] size_t blocks() const { return m_blocks.size(); }
+
+private:
+    // Os blocos dobram de tamanho ate MAX_BLOCK, entao arvores pequenas ocupam
+    // pouco e arvores grandes usam poucos blocos.
+    static constexpr size_t FIRST_BLOCK = 64 * 1024;
+    static constexpr size_t MAX_BLOCK = 4 * 1024 * 1024;
+
+    void* grow(size_t bytes, size_t alinhamento) {
+        size_t tamanho = m_next;
+        if (bytes + alinhamento > tamanho) tamanho = bytes + alinhamento;
+        if (m_next < MAX_BLOCK) m_next *= 2;
+        m_blocks.emplace_back(new char[tamanho]); // sem zerar: cada no e construido no lugar
+        m_cursor = m_blocks.back().get();
+        m_limit = m_cursor + tamanho;
+        m_reserved += tamanho;
+        return allocate(bytes, alinhamento);
+    }
+
+    std::vector<std::unique_ptr<char[]>> m_blocks;
+    char* m_cursor = nullptr;
+    char* m_limit = nullptr;
+    size_t m_next = FIRST_BLOCK;
+    size_t m_nodes = 0;
+    size_t m_used = 0;
+    size_t m_reserved = 0;
+};
+
+#endif
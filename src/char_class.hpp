@@ -0,0 +1,79 @@
+#ifndef CHAR_CLASS_HPP
+#define CHAR_CLASS_HPP
+
+#include <array>
+#include <cstdint>
+
+// Classes de caracteres do lexico em tabelas de 256 posicoes geradas em tempo
+// de compilacao. Classificar um byte e uma unica leitura indexada por
+// unsigned char: nao depende do locale e e valido para bytes >= 0x80 (UTF-8),
+// ao contrario de std::isalpha & cia com char negativo.
+namespace chars {
+
+// Propriedades testadas nos lacos de varredura (bits combinaveis)
+enum Flag : uint8_t {
+    ESPACO   = 1 << 0, // ' ' e '\t'..'\r'
+    LETRA    = 1 << 1, // A-Z a-z _
+    DIGITO   = 1 << 2, // 0-9
+    HEX      = 1 << 3, // 0-9 A-F a-f
+};
+
+// Estado inicial do automato do lexico: o que o primeiro byte do token decide
+enum class Acao : uint8_t {
+    INVALIDO,      // caractere inesperado
+    ESPACO,
+    IDENTIFICADOR,
+    NUMERO,
+    HEXADECIMAL,   // '$'
+    STRING,        // '\''
+    COMENTARIO,    // '{'
+    COMENTARIO_OU_OPERADOR, // '(' de "(*" ou '/' de "//"
+    OPERADOR,      // simbolo de um ou dois caracteres
+    UTF8,          // byte inicial de uma sequencia UTF-8 (so valida em strings e comentarios)
+};
+
+constexpr std::array<uint8_t, 256> buildFlags() {
+    std::array<uint8_t, 256> t {};
+    t[' '] = ESPACO;
+    for (int c = '\t'; c <= '\r'; c++) t[c] = ESPACO;
+    for (int c = 'a'; c <= 'z'; c++) t[c] = LETRA;
+    for (int c = 'A'; c <= 'Z'; c++) t[c] = LETRA;
+    t['_'] = LETRA;
+    for (int c = '0'; c <= '9'; c++) t[c] = DIGITO | HEX;
+    for (int c = 'a'; c <= 'f'; c++) t[c] |= HEX;
+    for (int c = 'A'; c <= 'F'; c++) t[c] |= HEX;
+    return t;
+}
+
+constexpr std::array<uint8_t, 256> FLAGS = buildFlags();
+
+constexpr std::array<Acao, 256> buildActions() {
+    std::array<Acao, 256> t {};
+    for (int c = 0; c < 256; c++) {
+        if (FLAGS[c] & ESPACO) t[c] = Acao::ESPACO;
+        else if (FLAGS[c] & LETRA) t[c] = Acao::IDENTIFICADOR;
+        else if (FLAGS[c] & DIGITO) t[c] = Acao::NUMERO;
+    }
+    for (unsigned char c : {'+', '-', '*', '/', '=', '<', '>', '(', ')', '[', ']', ';', ':', '.', ','}) t[c] = Acao::OPERADOR;
+    t['$'] = Acao::HEXADECIMAL;
+    t['\''] = Acao::STRING;
+    t['{'] = Acao::COMENTARIO;
+    t['('] = Acao::COMENTARIO_OU_OPERADOR;
+    t['/'] = Acao::COMENTARIO_OU_OPERADOR;
+    for (int c = 0xC2; c <= 0xF4; c++) t[c] = Acao::UTF8;
+    return t;
+}
+
+constexpr std::array<Acao, 256> ACOES = buildActions();
+
+constexpr bool is(unsigned char c, uint8_t flags) { return (FLAGS[c] & flags) != 0; }
+constexpr bool isSpace(char c) { return is(static_cast<unsigned char>(c), ESPACO); }
+constexpr bool isIdentifierStart(char c) { return is(static_cast<unsigned char>(c), LETRA); }
+constexpr bool isIdentifierChar(char c) { return is(static_cast<unsigned char>(c), LETRA | DIGITO); }
+constexpr bool isDigit(char c) { return is(static_cast<unsigned char>(c), DIGITO); }
+constexpr bool isHexDigit(char c) { return is(static_cast<unsigned char>(c), HEX); }
+constexpr Acao action(char c) { return ACOES[static_cast<unsigned char>(c)]; }
+
+} // namespace chars
+
+#endif
@@ -0,0 +1,173 @@
+#include "diagnostics.hpp"
+
+#include <cstdio>
+
+namespace {
+
+struct Descricao {
+    const char* nome;  // identificador estavel usado na saida JSON
+    const char* fase;
+    const char* texto; // {0}..{9}: argumentos; {linha}: linha do offset
+};
+
+// Indexada por DiagCode
+constexpr Descricao DESCRICOES[] = {
+    {"caractere-inesperado", "lexico", "Erro lexico: Caractere inesperado '{0}' na linha {linha}"},
+    {"string-nao-terminada", "lexico", "Erro lexico: String nao terminada na linha {linha}"},
+    {"inteiro-fora-do-intervalo", "lexico", "Erro lexico: Constante inteira '{0}' fora do intervalo na linha {linha}"},
+    {"real-fora-do-intervalo", "lexico", "Erro lexico: Constante real '{0}' fora do intervalo na linha {linha}"},
+    {"utf8-invalido", "lexico", "Erro lexico: Sequencia UTF-8 invalida na linha {linha}"},
+
+    {"token-esperado", "sintatico", "Erro sintatico: {0} (esperado '{1}', encontrado '{2}' na linha {linha})"},
+    {"token-esperado-no-fim", "sintatico", "Erro sintatico: {0}"},
+    {"fim-inesperado", "sintatico", "Fim inesperado do arquivo."},
+    {"comando-invalido", "sintatico", "Comando invalido ou inesperado na linha {linha}"},
+    {"expressao-invalida", "sintatico", "Expressao primaria inesperada na linha {linha}"},
+    {"aninhamento-excessivo", "sintatico", "Erro sintatico: Aninhamento acima de {0} niveis na linha {linha}"},
+
+    {"variavel-redeclarada", "semantico", "Erro Semantico (linha {linha}): Variavel '{0}' ja foi declarada."},
+    {"variavel-nao-declarada", "semantico", "Erro Semantico (linha {linha}): Variavel '{0}' nao foi declarada."},
+    {"atribuicao-controle-for", "semantico", "Erro Semantico (linha {linha}): A variavel de controle do laco FOR '{0}' nao pode ser modificada."},
+    {"atribuicao-tipos-incompativeis", "semantico", "Erro Semantico (linha {linha}): Incompatibilidade de tipos. Variavel '{0}' e do tipo {1} mas recebeu uma expressao do tipo {2}."},
+    {"condicao-if-nao-booleana", "semantico", "Erro Semantico: A condicao do 'if' deve ser do tipo BOOLEAN."},
+    {"condicao-while-nao-booleana", "semantico", "Erro Semantico: A condicao do 'while' deve ser do tipo BOOLEAN."},
+    {"condicao-until-nao-booleana", "semantico", "Erro Semantico: A condicao do 'until' deve ser do tipo BOOLEAN."},
+    {"controle-for-nao-declarado", "semantico", "Erro Semantico (linha {linha}): Variavel de controle do FOR '{0}' nao foi declarada."},
+    {"controle-for-nao-inteiro", "semantico", "Erro Semantico (linha {linha}): Variavel de controle do FOR '{0}' deve ser do tipo INTEGER."},
+    {"inicio-for-nao-inteiro", "semantico", "Erro Semantico (linha {linha}): A expressao inicial do FOR deve ser do tipo INTEGER."},
+    {"fim-for-nao-inteiro", "semantico", "Erro Semantico (linha {linha}): A expressao final do FOR deve ser do tipo INTEGER."},
+    {"variavel-usada-sem-declaracao", "semantico", "Erro Semantico (linha {linha}): Variavel '{0}' usada sem ser declarada."},
+    {"operador-tipos-incompativeis", "semantico", "Erro Semantico (linha {linha}): Tipos incompativeis para o operador '{0}'."},
+    {"elemento-conjunto-invalido", "semantico", "Erro Semantico (linha {linha}): Os elementos de um conjunto devem ser do tipo INTEGER, mas foi encontrado {0}."},
+    {"rotina-nao-declarada", "semantico", "Erro Semantico (linha {linha}): '{0}' nao e um procedimento ou funcao declarado."},
+    {"numero-de-argumentos", "semantico", "Erro Semantico (linha {linha}): '{0}' espera {1} argumento(s), mas recebeu {2}."},
+    {"argumento-tipos-incompativeis", "semantico", "Erro Semantico (linha {linha}): O argumento {0} de '{1}' deve ser do tipo {2}, mas e do tipo {3}."},
+    {"procedimento-sem-valor", "semantico", "Erro Semantico (linha {linha}): O procedimento '{0}' nao devolve valor e nao pode ser usado em uma expressao."},
+    {"erro-interno-semantico", "semantico", "Erro durante a analise semantica: {0}"},
+};
+
+static_assert(sizeof(DESCRICOES) / sizeof(DESCRICOES[0]) == static_cast<size_t>(DiagCode::INTERNAL_SEMANTIC) + 1,
+              "DESCRICOES deve ter uma entrada para cada DiagCode");
+
+const Descricao& describe(DiagCode code) { return DESCRICOES[static_cast<size_t>(code)]; }
+
+void writeJsonString(std::ostream& os, std::string_view s) {
+    os << '"';
+    for (char c : s) {
+        switch (c) {
+            case '"':  os << "\\\""; break;
+            case '\\': os << "\\\\"; break;
+            case '\n': os << "\\n"; break;
+            case '\t': os << "\\t"; break;
+            case '\r': os << "\\r"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char esc[8];
+                    std::snprintf(esc, sizeof(esc), "\\u%04x", static_cast<unsigned>(c));
+                    os << esc;
+                } else {
+                    os << c;
+                }
+        }
+    }
+    os << '"';
+}
+
+} // namespace
+
+void DiagnosticEngine::report(DiagCode code, uint32_t offset, std::initializer_list<std::string_view> args, Severity severity) {
+    Diagnostic d {severity, code, offset, {}};
+    d.args.reserve(args.size());
+    for (std::string_view a : args) d.args.emplace_back(a);
+    add(std::move(d));
+}
+
+void DiagnosticEngine::merge(const DiagnosticEngine& outro) {
+    for (const Diagnostic& d : outro.m_diagnostics) add(d);
+    m_suppressed += outro.m_suppressed;
+}
+
+void DiagnosticEngine::add(Diagnostic d) {
+    // Chave de deduplicacao: codigo, offset e argumentos separados por '\0'.
+    // Sem posicao nao ha como saber se e o mesmo erro, entao nada e descartado.
+    if (d.offset != NO_OFFSET) {
+        std::string chave;
+        chave += static_cast<char>(d.code);
+        chave.append(reinterpret_cast<const char*>(&d.offset), sizeof(d.offset));
+        for (const std::string& a : d.args) { chave += a; chave += '\0'; }
+        if (!m_seen.insert(std::move(chave)).second) return;
+    }
+
+    if (d.severity == Severity::ERROR) {
+        if (m_limit && m_errors >= m_limit) { m_suppressed++; return; }
+        m_errors++;
+    }
+    m_diagnostics.push_back(std::move(d));
+}
+
+std::string DiagnosticEngine::format(const Diagnostic& d) const {
+    std::string_view texto = describe(d.code).texto;
+    std::string saida;
+    saida.reserve(texto.size() + 32);
+    for (size_t i = 0; i < texto.size(); i++) {
+        if (texto[i] == '{') {
+            size_t fecha = texto.find('}', i);
+            std::string_view campo = texto.substr(i + 1, fecha - i - 1);
+            if (campo == "linha") {
+                // Sem posicao no fonte nao ha linha (como na saida JSON)
+                if (d.offset != NO_OFFSET) saida += std::to_string(m_sources->decode(d.offset).line);
+            } else {
+                size_t n = static_cast<size_t>(campo[0] - '0');
+                if (n < d.args.size()) saida += d.args[n];
+            }
+            i = fecha;
+        } else {
+            saida += texto[i];
+        }
+    }
+    return saida;
+}
+
+void DiagnosticEngine::print(std::ostream& os, Format formato) const {
+    if (formato == Format::TEXT) {
+        // Com um unico arquivo o nome e omitido, como antes do SourceManager
+        const bool variosArquivos = m_sources->files() > 1;
+        std::string saida;
+        for (const Diagnostic& d : m_diagnostics) {
+            if (variosArquivos && d.offset != NO_OFFSET) saida += m_sources->name(m_sources->fileOf(d.offset)) + ": ";
+            saida += format(d);
+            saida += '\n';
+        }
+        if (m_suppressed) {
+            saida += "Limite de " + std::to_string(m_limit) + " erros atingido; " +
+                     std::to_string(m_suppressed) + " diagnosticos omitidos.\n";
+        }
+        os << saida;
+        os.flush();
+        return;
+    }
+
+    os << "{\"diagnosticos\":[";
+    for (size_t i = 0; i < m_diagnostics.size(); i++) {
+        const Diagnostic& d = m_diagnostics[i];
+        const Descricao& desc = describe(d.code);
+        os << (i ? ",\n" : "\n") << "{\"codigo\":\"" << desc.nome << "\",\"fase\":\"" << desc.fase
+           << "\",\"severidade\":\"" << (d.severity == Severity::ERROR ? "erro" : "aviso") << "\"";
+        if (d.offset != NO_OFFSET) {
+            SourceManager::Location pos = m_sources->decode(d.offset);
+            os << ",\"arquivo\":";
+            writeJsonString(os, m_sources->name(pos.file));
+            os << ",\"offset\":" << d.offset - m_sources->base(pos.file) << ",\"linha\":" << pos.line << ",\"coluna\":" << pos.col;
+        }
+        os << ",\"argumentos\":[";
+        for (size_t a = 0; a < d.args.size(); a++) {
+            if (a) os << ',';
+            writeJsonString(os, d.args[a]);
+        }
+        os << "],\"mensagem\":";
+        writeJsonString(os, format(d));
+        os << '}';
+    }
+    os << "\n],\"omitidos\":" << m_suppressed << "}\n";
+    os.flush();
+}
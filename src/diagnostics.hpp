@@ -0,0 +1,81 @@
+#ifndef DIAGNOSTICS_HPP
+#define DIAGNOSTICS_HPP
+
+#include <cstdint>
+#include <initializer_list>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "source_manager.hpp"
+
+enum class Severity : uint8_t { ERROR, WARNING };
+
+// Codigo de cada diagnostico. O texto de cada um fica na tabela de
+// diagnostics.cpp; os argumentos preenchem os campos {0}, {1}, ... do texto.
+enum class DiagCode : uint8_t {
+    // Lexicos
+    UNEXPECTED_CHAR, UNTERMINATED_STRING, INT_OUT_OF_RANGE, REAL_OUT_OF_RANGE, INVALID_UTF8,
+    // Sintaticos
+    EXPECTED_TOKEN, EXPECTED_AT_EOF, UNEXPECTED_EOF, INVALID_STATEMENT, INVALID_EXPRESSION, NESTING_TOO_DEEP,
+    // Semanticos
+    REDECLARED_VARIABLE, UNDECLARED_VARIABLE, ASSIGN_TO_FOR_CONTROL, ASSIGN_TYPE_MISMATCH,
+    IF_NOT_BOOLEAN, WHILE_NOT_BOOLEAN, UNTIL_NOT_BOOLEAN,
+    FOR_UNDECLARED_CONTROL, FOR_CONTROL_NOT_INTEGER, FOR_START_NOT_INTEGER, FOR_END_NOT_INTEGER,
+    USED_UNDECLARED, OPERATOR_TYPE_MISMATCH, SET_ELEMENT_NOT_INTEGER,
+    NOT_A_ROUTINE, ARG_COUNT_MISMATCH, ARG_TYPE_MISMATCH, PROCEDURE_IN_EXPRESSION, INTERNAL_SEMANTIC,
+};
+
+struct Diagnostic {
+    Severity severity;
+    DiagCode code;
+    uint32_t offset; // posicao global (SourceManager); NO_OFFSET quando nao ha posicao no fonte
+    std::vector<std::string> args;
+};
+
+// Coleta os diagnosticos de todas as fases em vez de escrever cada um em
+// std::cerr assim que aparece. A posicao e guardada como offset global e so vira
+// arquivo/linha/coluna na formatacao, feita uma unica vez no fim (texto ou JSON).
+// Diagnosticos repetidos (mesmo codigo, posicao e argumentos) sao descartados
+// e, com um limite definido, os erros excedentes sao apenas contados.
+class DiagnosticEngine {
+public:
+    static constexpr uint32_t NO_OFFSET = UINT32_MAX;
+
+    enum class Format : uint8_t { TEXT, JSON };
+
+    // 'fontes' decodifica os offsets; so e consultado na formatacao.
+    explicit DiagnosticEngine(const SourceManager& fontes) : m_sources(&fontes) {}
+
+    [[nodiscard]] const SourceManager& sources() const { return *m_sources; }
+
+    // 0 = sem limite
+    void setErrorLimit(size_t limite) { m_limit = limite; }
+
+    void report(DiagCode code, uint32_t offset, std::initializer_list<std::string_view> args = {},
+                Severity severity = Severity::ERROR);
+    // Acrescenta os diagnosticos de 'outro' na ordem em que foram registrados (usado na costura do lexico paralelo).
+    void merge(const DiagnosticEngine& outro);
+
+    [[nodiscard]] const std::vector<Diagnostic>& diagnostics() const { return m_diagnostics; }
+    [[nodiscard]] size_t errorCount() const { return m_errors; }
+    [[nodiscard]] size_t suppressed() const { return m_suppressed; }
+    [[nodiscard]] bool empty() const { return m_diagnostics.empty() && m_suppressed == 0; }
+
+    [[nodiscard]] std::string format(const Diagnostic& d) const;
+    void print(std::ostream& os, Format formato = Format::TEXT) const;
+
+private:
+    void add(Diagnostic d);
+
+    const SourceManager* m_sources;
+    std::vector<Diagnostic> m_diagnostics;
+    std::unordered_set<std::string> m_seen;
+    size_t m_limit = 0;
+    size_t m_errors = 0;
+    size_t m_suppressed = 0;
+};
+
+#endif
@@ -0,0 +1,242 @@
+#include "flat_ast.hpp"
+
+#include <algorithm>
+
+namespace {
+
+// Filhos de cada no na ordem em que devem ser gravados (nulos entram como NONE)
+template <class F>
+void forEachChild(const Node* node, F&& f) {
+    switch (node->kind) {
+        case AstKind::PROGRAM: {
+            auto p = static_cast<const ProgramNode*>(node);
+            f(p->vars);
+            for (const StmtNode* r : p->routines) f(r);
+            f(p->mainBlock);
+            break;
+        }
+        case AstKind::ROUTINE: {
+            auto p = static_cast<const FunctionDeclNode*>(node);
+            f(p->vars);
+            f(p->body);
+            break;
+        }
+        case AstKind::PROC_CALL:
+            for (const ExprNode* e : static_cast<const ProcCallNode*>(node)->args) f(e);
+            break;
+        case AstKind::FUNC_CALL:
+            for (const ExprNode* e : static_cast<const FuncCallNode*>(node)->args) f(e);
+            break;
+        case AstKind::BLOCK:
+            for (const StmtNode* s : static_cast<const BlockNode*>(node)->statements) f(s);
+            break;
+        case AstKind::IF: {
+            auto p = static_cast<const IfNode*>(node);
+            f(p->cond);
+            f(p->thenBr);
+            f(p->elseBr);
+            break;
+        }
+        case AstKind::WHILE: {
+            auto p = static_cast<const WhileNode*>(node);
+            f(p->cond);
+            f(p->body);
+            break;
+        }
+        case AstKind::FOR: {
+            auto p = static_cast<const ForNode*>(node);
+            f(p->start);
+            f(p->end);
+            f(p->body);
+            break;
+        }
+        case AstKind::REPEAT: {
+            auto p = static_cast<const RepeatNode*>(node);
+            for (const StmtNode* s : p->body) f(s);
+            f(p->cond);
+            break;
+        }
+        case AstKind::ASSIGN:
+            f(static_cast<const AssignNode*>(node)->value);
+            break;
+        case AstKind::BINARY_OP: {
+            auto p = static_cast<const BinaryOpNode*>(node);
+            f(p->left);
+            f(p->right);
+            break;
+        }
+        case AstKind::UNARY_OP:
+            f(static_cast<const UnaryOpNode*>(node)->operand);
+            break;
+        case AstKind::SET:
+            for (const ExprNode* e : static_cast<const SetNode*>(node)->elements) f(e);
+            break;
+        case AstKind::VAR_SECTION:
+        case AstKind::VAR_DECL:
+        case AstKind::LITERAL:
+        case AstKind::IDENTIFIER:
+            break;
+    }
+}
+
+} // namespace
+
+FlatAst FlatAst::flatten(const ProgramNode* programa) {
+    FlatAst ast;
+    if (!programa) return ast;
+
+    // Pos-ordem com pilha explicita: um no com filhos e visitado duas vezes, a
+    // primeira empilha os filhos e a segunda grava o no com os indices ja
+    // produzidos por eles, que ficam no topo de 'feitos'. Folhas sao gravadas
+    // na primeira visita.
+    struct Frame {
+        const Node* node;
+        uint32_t filhos; // UINT32_MAX enquanto os filhos nao foram empilhados
+    };
+    constexpr uint32_t NAO_EXPANDIDO = UINT32_MAX;
+    std::vector<Frame> pilha {{programa, NAO_EXPANDIDO}};
+    std::vector<uint32_t> feitos;
+    std::vector<uint32_t> declaracoes;
+
+    while (!pilha.empty()) {
+        Frame f = pilha.back();
+        pilha.pop_back();
+        if (!f.node) {
+            feitos.push_back(NONE);
+            continue;
+        }
+        if (f.filhos == NAO_EXPANDIDO) {
+            const size_t topo = pilha.size();
+            pilha.push_back(f);
+            forEachChild(f.node, [&pilha](const Node* c) { pilha.push_back({c, NAO_EXPANDIDO}); });
+            const uint32_t n = static_cast<uint32_t>(pilha.size() - topo - 1);
+            if (n > 0) {
+                pilha[topo].filhos = n;
+                std::reverse(pilha.begin() + static_cast<std::ptrdiff_t>(topo) + 1, pilha.end());
+                continue;
+            }
+            pilha.pop_back();
+        }
+
+        const Node* node = f.node;
+        const uint32_t n = f.filhos == NAO_EXPANDIDO ? 0 : f.filhos;
+        const uint32_t* c = feitos.data() + feitos.size() - n;
+        FlatNode novo {node->kind, Tipo_de_token::IDENTIFIER, 0, 0, NONE, NONE};
+
+        switch (node->kind) {
+            case AstKind::PROGRAM: {
+                auto p = static_cast<const ProgramNode*>(node);
+                novo.offset = p->name.offset;
+                novo.lhs = c[0];
+                novo.rhs = ast.addFixed(c + n - 1, 1);
+                ast.addList(c + 1, n - 2);
+                break;
+            }
+            case AstKind::ROUTINE: {
+                auto p = static_cast<const FunctionDeclNode*>(node);
+                novo.token = p->isFunction ? p->resultType.type : Tipo_de_token::PROCEDURE;
+                novo.aux = p->isFunction;
+                novo.offset = p->name.offset;
+                novo.lhs = p->name.symbol();
+                declaracoes.clear();
+                for (const ParamEntry& e : p->params) {
+                    declaracoes.push_back(ast.add({AstKind::VAR_DECL, e.type.type, e.byRef, e.name.offset, e.name.symbol(), e.type.offset}));
+                }
+                novo.rhs = ast.addFixed(c, 2);
+                ast.addList(declaracoes.data(), static_cast<uint32_t>(declaracoes.size()));
+                break;
+            }
+            case AstKind::PROC_CALL:
+            case AstKind::FUNC_CALL: {
+                // Os dois nos tem o mesmo layout (nome + argumentos)
+                const Token& nome = node->kind == AstKind::PROC_CALL ? static_cast<const ProcCallNode*>(node)->name
+                                                                     : static_cast<const FuncCallNode*>(node)->name;
+                novo.offset = nome.offset;
+                novo.lhs = nome.symbol();
+                novo.rhs = ast.addList(c, n);
+                break;
+            }
+            case AstKind::VAR_SECTION: {
+                declaracoes.clear();
+                for (const VarEntry& e : static_cast<const VarSectionNode*>(node)->entries) {
+                    declaracoes.push_back(ast.add({AstKind::VAR_DECL, e.type.type, 0, e.name.offset, e.name.symbol(), e.type.offset}));
+                }
+                novo.lhs = ast.addList(declaracoes.data(), static_cast<uint32_t>(declaracoes.size()));
+                break;
+            }
+            case AstKind::BLOCK:
+                novo.lhs = ast.addList(c, n);
+                break;
+            case AstKind::IF:
+                novo.lhs = c[0];
+                novo.rhs = ast.addFixed(c + 1, 2);
+                break;
+            case AstKind::WHILE:
+                novo.lhs = c[0];
+                novo.rhs = c[1];
+                break;
+            case AstKind::FOR: {
+                auto p = static_cast<const ForNode*>(node);
+                novo.aux = p->toUp;
+                novo.offset = p->var.offset;
+                novo.lhs = p->var.symbol();
+                novo.rhs = ast.addFixed(c, 3);
+                break;
+            }
+            case AstKind::REPEAT:
+                novo.lhs = ast.addList(c, n - 1);
+                novo.rhs = c[n - 1];
+                break;
+            case AstKind::ASSIGN: {
+                auto p = static_cast<const AssignNode*>(node);
+                novo.offset = p->target.offset;
+                novo.lhs = p->target.symbol();
+                novo.rhs = c[0];
+                break;
+            }
+            case AstKind::LITERAL: {
+                const Token& t = static_cast<const LiteralNode*>(node)->value;
+                novo.token = t.type;
+                novo.offset = t.offset;
+                novo.lhs = static_cast<uint32_t>(t.payload);
+                novo.rhs = static_cast<uint32_t>(t.payload >> 32);
+                break;
+            }
+            case AstKind::IDENTIFIER: {
+                const Token& t = static_cast<const IdentifierNode*>(node)->identifier;
+                novo.offset = t.offset;
+                novo.lhs = t.symbol();
+                break;
+            }
+            case AstKind::BINARY_OP: {
+                const Token& op = static_cast<const BinaryOpNode*>(node)->op;
+                novo.token = op.type;
+                novo.aux = static_cast<uint16_t>(op.length);
+                novo.offset = op.offset;
+                novo.lhs = c[0];
+                novo.rhs = c[1];
+                break;
+            }
+            case AstKind::UNARY_OP: {
+                const Token& op = static_cast<const UnaryOpNode*>(node)->op;
+                novo.token = op.type;
+                novo.aux = static_cast<uint16_t>(op.length);
+                novo.offset = op.offset;
+                novo.lhs = c[0];
+                break;
+            }
+            case AstKind::SET:
+                novo.offset = static_cast<const SetNode*>(node)->open.offset;
+                novo.lhs = ast.addList(c, n);
+                break;
+            case AstKind::VAR_DECL:
+                break;
+        }
+
+        feitos.resize(feitos.size() - n);
+        feitos.push_back(ast.add(novo));
+    }
+
+    ast.m_root = feitos.back();
+    return ast;
+}
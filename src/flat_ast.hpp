@@ -0,0 +1,114 @@
+#ifndef FLAT_AST_HPP
+#define FLAT_AST_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "parser.hpp"
+
+// No da AST plana: 16 bytes, sem ponteiros. Os filhos sao indices no vetor de
+// nos e listas de tamanho variavel ficam no vetor 'extra' como [n, itens...].
+//
+//   kind         token        aux          offset             lhs                 rhs
+//   PROGRAM      -            -            nome               VAR_SECTION/NONE    extra: [BLOCK, n, ROUTINE...]
+//   ROUTINE      resultado*   1 = funcao   nome               simbolo             extra: [VAR_SECTION/NONE, BLOCK, n, VAR_DECL...]
+//   VAR_SECTION  -            -            -                  lista de VAR_DECL   -
+//   VAR_DECL     tipo         1 = var      nome               simbolo             offset do tipo
+//   BLOCK        -            -            -                  lista de comandos   -
+//   IF           -            -            -                  condicao            extra: [then, else/NONE]
+//   WHILE        -            -            -                  condicao            corpo
+//   FOR          -            1 = to       variavel           simbolo             extra: [inicio, fim, corpo]
+//   REPEAT       -            -            -                  lista de comandos   condicao
+//   ASSIGN       -            -            alvo               simbolo             valor
+//   LITERAL      tipo         -            literal            payload (32 bits baixos)  payload (altos)
+//   IDENTIFIER   -            -            identificador      simbolo             -
+//   BINARY_OP    operador     tamanho      operador           esquerda            direita
+//   UNARY_OP     operador     tamanho      operador           operando            -
+//   SET          -            -            '['                lista de elementos  -
+//   PROC_CALL    -            -            nome               simbolo             lista de argumentos
+//   FUNC_CALL    -            -            nome               simbolo             lista de argumentos
+//
+// (*) PROCEDURE nos procedimentos. Os VAR_DECL de uma rotina sao os parametros;
+// aux = 1 marca parametro por referencia.
+//
+// As expressoes sao gravadas em pos-ordem: a subarvore de uma expressao ocupa
+// um intervalo continuo que termina na raiz, e os tipos podem ser calculados
+// com uma unica passada linear por ele (ver exprBegin()).
+struct FlatNode {
+    AstKind kind;
+    Tipo_de_token token;
+    uint16_t aux;
+    uint32_t offset;
+    uint32_t lhs;
+    uint32_t rhs;
+};
+static_assert(sizeof(FlatNode) == 16, "FlatNode deve ocupar 16 bytes");
+
+class FlatAst {
+public:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    // Lista guardada em 'extra'
+    struct List {
+        const uint32_t* first;
+        uint32_t count;
+        [[nodiscard]] const uint32_t* begin() const { return first; }
+        [[nodiscard]] const uint32_t* end() const { return first + count; }
+    };
+
+    [[nodiscard]] uint32_t root() const { return m_root; }
+    [[nodiscard]] size_t size() const { return m_nodes.size(); }
+    [[nodiscard]] const FlatNode& operator[](uint32_t i) const { return m_nodes[i]; }
+    [[nodiscard]] uint32_t extra(uint32_t i) const { return m_extra[i]; }
+    [[nodiscard]] List list(uint32_t inicio) const { return {m_extra.data() + inicio + 1, m_extra[inicio]}; }
+
+    [[nodiscard]] static uint64_t payload(const FlatNode& n) { return n.lhs | static_cast<uint64_t>(n.rhs) << 32; }
+
+    // Primeiro no da subarvore da expressao 'raiz' (a folha mais a esquerda;
+    // um conjunto vazio e o proprio inicio)
+    [[nodiscard]] uint32_t exprBegin(uint32_t raiz) const {
+        for (;;) {
+            const FlatNode& n = m_nodes[raiz];
+            if (n.kind == AstKind::BINARY_OP || n.kind == AstKind::UNARY_OP) {
+                raiz = n.lhs;
+            } else if (n.kind == AstKind::SET && m_extra[n.lhs] > 0) {
+                raiz = m_extra[n.lhs + 1];
+            } else if (n.kind == AstKind::FUNC_CALL && m_extra[n.rhs] > 0) {
+                raiz = m_extra[n.rhs + 1];
+            } else {
+                return raiz;
+            }
+        }
+    }
+
+    [[nodiscard]] size_t bytes() const {
+        return m_nodes.capacity() * sizeof(FlatNode) + m_extra.capacity() * sizeof(uint32_t);
+    }
+
+    // Converte a AST de ponteiros, sem recursao (a profundidade nao depende da pilha).
+    static FlatAst flatten(const ProgramNode* programa);
+
+private:
+    uint32_t add(const FlatNode& n) {
+        m_nodes.push_back(n);
+        return static_cast<uint32_t>(m_nodes.size() - 1);
+    }
+    uint32_t addList(const uint32_t* itens, uint32_t n) {
+        uint32_t inicio = static_cast<uint32_t>(m_extra.size());
+        m_extra.push_back(n);
+        m_extra.insert(m_extra.end(), itens, itens + n);
+        return inicio;
+    }
+    // Campos de tamanho fixo (IF, FOR), sem o contador
+    uint32_t addFixed(const uint32_t* itens, uint32_t n) {
+        uint32_t inicio = static_cast<uint32_t>(m_extra.size());
+        m_extra.insert(m_extra.end(), itens, itens + n);
+        return inicio;
+    }
+
+    std::vector<FlatNode> m_nodes;
+    std::vector<uint32_t> m_extra;
+    uint32_t m_root = NONE;
+};
+
+#endif
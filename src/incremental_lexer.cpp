@@ -0,0 +1,120 @@
+#include "incremental_lexer.hpp"
+
+#include <algorithm>
+
+namespace {
+
+// Bytes alem do fim de um token que o lexico pode examinar para decidir onde
+// ele termina (o pior caso e "1e+5": depois do '1' sao lidos 'e', '+' e '5').
+constexpr uint32_t LOOKAHEAD_BYTES = 3;
+
+} // namespace
+
+IncrementalLexer::IncrementalLexer(std::string fonte) : m_source(std::move(fonte)) {
+    m_source.append(scan::PADDING, '\0');
+    m_sources.emplace();
+    m_sources->addBuffer("<edicao>", source());
+    m_lastDiagnostics.emplace(*m_sources);
+    Tokenizer tokenizer(source(), m_symbols, *m_lastDiagnostics);
+    m_buffer = tokenizer.tokenize();
+    m_gapStart = m_gapEnd = m_buffer.size();
+    m_lastRelexed = m_buffer.size();
+}
+
+Token IncrementalLexer::token(size_t i) const {
+    if (i < m_gapStart) return m_buffer[i];
+    Token t = m_buffer[i + gapLength()];
+    t.offset = static_cast<uint32_t>(source().size()) - t.offset;
+    return t;
+}
+
+std::vector<Token> IncrementalLexer::tokens() const {
+    std::vector<Token> todos;
+    todos.reserve(size());
+    for (size_t i = 0; i < size(); i++) todos.push_back(token(i));
+    return todos;
+}
+
+void IncrementalLexer::moveGap(size_t posicao) {
+    const uint32_t total = static_cast<uint32_t>(source().size());
+    while (m_gapStart > posicao) {
+        Token t = m_buffer[--m_gapStart];
+        t.offset = total - t.offset;
+        m_buffer[--m_gapEnd] = t;
+    }
+    while (m_gapStart < posicao) {
+        Token t = m_buffer[m_gapEnd++];
+        t.offset = total - t.offset;
+        m_buffer[m_gapStart++] = t;
+    }
+}
+
+void IncrementalLexer::reserveGap(size_t n) {
+    if (gapLength() >= n) return;
+    size_t depois = m_buffer.size() - m_gapEnd;
+    size_t novoGap = std::max(n, m_buffer.size() / 2 + 64);
+    std::vector<Token> maior(m_gapStart + novoGap + depois);
+    std::copy(m_buffer.begin(), m_buffer.begin() + m_gapStart, maior.begin());
+    std::copy(m_buffer.begin() + m_gapEnd, m_buffer.end(), maior.begin() + m_gapStart + novoGap);
+    m_buffer = std::move(maior);
+    m_gapEnd = m_gapStart + novoGap;
+}
+
+size_t IncrementalLexer::firstAffected(uint32_t offset) const {
+    size_t lo = 0, hi = size();
+    while (lo < hi) {
+        size_t meio = lo + (hi - lo) / 2;
+        Token t = token(meio);
+        if (t.offset + t.length + LOOKAHEAD_BYTES <= offset) lo = meio + 1;
+        else hi = meio;
+    }
+    return lo;
+}
+
+void IncrementalLexer::apply(const TextEdit& edicao) {
+    const uint32_t fimAntigo = edicao.offset + edicao.removed;
+    const int64_t delta = static_cast<int64_t>(edicao.inserted.size()) - edicao.removed;
+
+    // Os tokens anteriores a 'primeiro' nao leram nenhum byte editado. O lexico
+    // recomeca no fim do ultimo deles, posicao que esta sempre fora de comentarios e strings.
+    const size_t primeiro = firstAffected(edicao.offset);
+    uint32_t reinicio = 0;
+    if (primeiro > 0) {
+        Token anterior = token(primeiro - 1);
+        reinicio = anterior.offset + anterior.length;
+    }
+
+    // Depois de mover o gap, os tokens antigos a partir de 'primeiro' ficam logo apos ele
+    moveGap(primeiro);
+    const uint32_t totalAntigo = static_cast<uint32_t>(source().size());
+    const size_t antigos = m_buffer.size() - m_gapEnd;
+    auto offsetAntigo = [&](size_t j) { return totalAntigo - m_buffer[m_gapEnd + j].offset; };
+
+    m_source.replace(edicao.offset, edicao.removed, edicao.inserted);
+    m_lastDiagnostics.reset();
+    m_sources.emplace();
+    m_sources->addBuffer("<edicao>", source());
+    m_lastDiagnostics.emplace(*m_sources);
+    Tokenizer tokenizer(source(), m_symbols, *m_lastDiagnostics, reinicio, source().size());
+
+    // Reanalisa ate produzir um token que comeca onde comecava um token antigo
+    // posterior a edicao; dali em diante os tokens antigos continuam validos.
+    std::vector<Token> novos;
+    size_t descartados = antigos;
+    size_t j = 0;
+    while (std::optional<Token> t = tokenizer.next()) {
+        while (j < antigos && (offsetAntigo(j) < fimAntigo || offsetAntigo(j) + delta < t->offset)) j++;
+        if (j < antigos && offsetAntigo(j) + delta == t->offset) {
+            descartados = j;
+            break;
+        }
+        novos.push_back(*t);
+    }
+
+    // Troca os antigos [0, descartados) pelos novos; os demais ja sao relativos ao fim
+    m_gapEnd += descartados;
+    reserveGap(novos.size());
+    for (const Token& t : novos) m_buffer[m_gapStart++] = t;
+
+    m_lastRelexed = novos.size();
+}
\ No newline at end of file
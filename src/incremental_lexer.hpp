@@ -0,0 +1,67 @@
+#ifndef INCREMENTAL_LEXER_HPP
+#define INCREMENTAL_LEXER_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "tokenization.hpp"
+
+// Edicao no texto: 'removed' bytes a partir de 'offset' sao trocados por 'inserted'.
+struct TextEdit {
+    uint32_t offset = 0;
+    uint32_t removed = 0;
+    std::string inserted;
+};
+
+// Analise lexica incremental para editores e modos de observacao de arquivos.
+// Depois de uma edicao, apenas a regiao danificada e reanalisada: o lexico
+// recomeca no fim do ultimo token intacto antes da edicao e para assim que
+// produz um token que comeca na mesma posicao (ja deslocada) de um token antigo
+// posterior a edicao; dali em diante a saida seria identica.
+//
+// Os tokens ficam num gap buffer posicionado na ultima edicao. Antes do gap os
+// offsets sao absolutos; depois dele sao guardados como distancia ate o fim do
+// texto, entao uma edicao nao precisa corrigir os tokens seguintes. O custo de
+// uma edicao e proporcional aos tokens alterados mais a distancia desde a
+// edicao anterior, e nao ao tamanho do arquivo.
+class IncrementalLexer {
+public:
+    explicit IncrementalLexer(std::string fonte);
+
+    void apply(const TextEdit& edicao);
+
+    [[nodiscard]] std::string_view source() const { return {m_source.data(), m_source.size() - scan::PADDING}; }
+    [[nodiscard]] const Interner& symbols() const { return m_symbols; }
+    [[nodiscard]] const LineIndex& lines() const { return m_sources->lines(0); }
+
+    [[nodiscard]] size_t size() const { return m_buffer.size() - gapLength(); }
+    [[nodiscard]] Token token(size_t i) const;
+    [[nodiscard]] std::vector<Token> tokens() const;
+
+    // Tokens produzidos na ultima edicao e diagnosticos lexicos desse trecho
+    [[nodiscard]] size_t lastRelexed() const { return m_lastRelexed; }
+    [[nodiscard]] const DiagnosticEngine& lastDiagnostics() const { return *m_lastDiagnostics; }
+
+private:
+    [[nodiscard]] size_t gapLength() const { return m_gapEnd - m_gapStart; }
+    void moveGap(size_t posicao);
+    void reserveGap(size_t n);
+    // Primeiro token cuja analise pode ter lido o byte 'offset'
+    [[nodiscard]] size_t firstAffected(uint32_t offset) const;
+
+    std::string m_source; // texto seguido de scan::PADDING bytes NUL para o Tokenizer
+    std::optional<SourceManager> m_sources; // um unico arquivo, refeito a cada edicao
+    Interner m_symbols;
+
+    std::vector<Token> m_buffer;
+    size_t m_gapStart = 0;
+    size_t m_gapEnd = 0;
+
+    size_t m_lastRelexed = 0;
+    std::optional<DiagnosticEngine> m_lastDiagnostics;
+};
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef INTERNER_HPP
+#define INTERNER_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "ascii_fold.hpp"
+
+// Tabela global de identificadores. Cada nome distinto recebe um ID denso de
+// 32 bits na ordem da primeira ocorrencia; o lexico preenche a tabela e as
+// fases seguintes comparam e indexam pelo ID em vez de usar strings.
+// Os nomes sao copiados uma unica vez para blocos proprios, entao continuam
+// validos mesmo que o buffer fonte seja liberado. Como em Pascal, a busca nao
+// diferencia maiusculas; name() devolve a grafia da primeira ocorrencia.
+class Interner {
+public:
+    Interner() = default;
+    Interner(const Interner&) = delete;
+    Interner& operator=(const Interner&) = delete;
+    Interner(Interner&&) = default;
+    Interner& operator=(Interner&&) = default;
+
+    uint32_t intern(std::string_view nome) {
+        auto it = m_ids.find(nome);
+        if (it != m_ids.end()) return it->second;
+        std::string_view copia = store(nome);
+        uint32_t id = static_cast<uint32_t>(m_names.size());
+        m_names.push_back(copia);
+        m_ids.emplace(copia, id);
+        return id;
+    }
+
+    [[nodiscard]] std::string_view name(uint32_t id) const { return m_names[id]; }
+    [[nodiscard]] size_t size() const { return m_names.size(); }
+
+private:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    std::string_view store(std::string_view nome) {
+        if (nome.size() > m_free) {
+            size_t tamanho = nome.size() > BLOCK_SIZE ? nome.size() : BLOCK_SIZE;
+            m_blocks.push_back(std::make_unique<char[]>(tamanho));
+            m_cursor = m_blocks.back().get();
+            m_free = tamanho;
+        }
+        std::memcpy(m_cursor, nome.data(), nome.size());
+        std::string_view copia(m_cursor, nome.size());
+        m_cursor += nome.size();
+        m_free -= nome.size();
+        return copia;
+    }
+
+    std::vector<std::string_view> m_names;
+    std::unordered_map<std::string_view, uint32_t, fold::Hash, fold::Equal> m_ids;
+    std::vector<std::unique_ptr<char[]>> m_blocks;
+    char* m_cursor = nullptr;
+    size_t m_free = 0;
+};
+
+#endif
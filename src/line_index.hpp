@@ -0,0 +1,53 @@
+#ifndef LINE_INDEX_HPP
+#define LINE_INDEX_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include "utf8.hpp"
+
+// Converte offsets do buffer fonte em linha/coluna sob demanda.
+// Os tokens guardam apenas o offset; a tabela com o inicio de cada linha so e
+// construida no primeiro diagnostico e cada consulta e uma busca binaria.
+// A coluna conta code points UTF-8 (nao bytes) e so e calculada na consulta.
+class LineIndex {
+public:
+    struct Position { int line; int col; };
+
+    explicit LineIndex(std::string_view fonte) : m_fonte(fonte) {}
+
+    LineIndex(const LineIndex&) = delete;
+    LineIndex& operator=(const LineIndex&) = delete;
+
+    [[nodiscard]] Position position(uint32_t offset) const {
+        std::call_once(m_built, [this] { build(); });
+        auto it = std::upper_bound(m_starts.begin(), m_starts.end(), offset);
+        size_t linha = static_cast<size_t>(it - m_starts.begin());
+        const uint32_t inicio = m_starts[linha - 1];
+        return {static_cast<int>(linha), static_cast<int>(utf8::countCodePoints(m_fonte.data() + inicio, offset - inicio)) + 1};
+    }
+
+    [[nodiscard]] int line(uint32_t offset) const { return position(offset).line; }
+
+private:
+    void build() const {
+        m_starts.push_back(0);
+        const char* inicio = m_fonte.data();
+        const char* p = inicio;
+        const char* fim = inicio + m_fonte.size();
+        while (const void* nl = std::memchr(p, '\n', static_cast<size_t>(fim - p))) {
+            p = static_cast<const char*>(nl) + 1;
+            m_starts.push_back(static_cast<uint32_t>(p - inicio));
+        }
+    }
+
+    std::string_view m_fonte;
+    mutable std::once_flag m_built;
+    mutable std::vector<uint32_t> m_starts;
+};
+
+#endif
@@ -1,10 +1,21 @@
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <vector>
 #include <memory>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#include "source_manager.hpp"
+#include "utf8.hpp"
 #include "tokenization.hpp"
+#include "parallel_lexer.hpp"
+#include "parallel_parser.hpp"
+#include "token_cache.hpp"
 #include "parser.hpp"
 #include "analisador_semantico.hpp"
 
@@ -39,6 +50,7 @@ inline std::ostream& operator<<(std::ostream& os, Tipo_de_token type) {
         case Tipo_de_token::AND: return os << "AND";
         case Tipo_de_token::NOT: return os << "NOT";
         case Tipo_de_token::DIV: return os << "DIV";
+        case Tipo_de_token::MOD: return os << "MOD";
         case Tipo_de_token::IDENTIFIER: return os << "IDENTIFIER";
         case Tipo_de_token::INTEGER: return os << "INTEGER";
         case Tipo_de_token::REAL: return os << "REAL";
@@ -71,44 +83,270 @@ inline std::ostream& operator<<(std::ostream& os, Tipo_de_token type) {
     }
 }
 
+// Percurso com o padrao de acesso do Parser em lote, usado por --comparar-layout:
+// o tipo de todo token e consultado e so identificadores e literais, que vao
+// para a AST, sao lidos por inteiro. A soma impede que o laco seja descartado.
+template <class Tipo, class Completo>
+static uint64_t percorrerTokens(size_t n, Tipo tipo, Completo completo) {
+    uint64_t soma = 0;
+    for (size_t i = 0; i < n; i++) {
+        const Tipo_de_token t = tipo(i);
+        soma += static_cast<uint8_t>(t);
+        if (t >= Tipo_de_token::IDENTIFIER && t <= Tipo_de_token::STRING_LIT) {
+            const Token tok = completo(i);
+            soma += tok.offset + tok.length + tok.payload;
+        }
+    }
+    return soma;
+}
+
+// Pico de memoria residente do processo em KB (0 se a plataforma nao informa)
+static long peakRssKb() {
+#if defined(__unix__) || defined(__APPLE__)
+    struct rusage uso {};
+    if (getrusage(RUSAGE_SELF, &uso) != 0) return 0;
+#if defined(__APPLE__)
+    return uso.ru_maxrss / 1024; // bytes no macOS
+#else
+    return uso.ru_maxrss;
+#endif
+#else
+    return 0;
+#endif
+}
+
 int main(int argc, char *argv[]){
 
-    if(argc != 2){
-        std::cerr << "Uso incorreto. Correto: ./compiler <arquivo_de_codigo.pas>" << std::endl;
+    // --estatisticas imprime o tempo de cada fase e a memoria ocupada pelos tokens
+    // --lote gera todos os tokens antes da analise sintatica (por padrao eles sao produzidos sob demanda)
+    // --paralelo[=N] faz como --lote, mas divide a analise lexica e a sintatica das rotinas entre N threads (padrao: todos os nucleos)
+    // --diagnosticos=texto|json escolhe o formato das mensagens de erro (impressas no fim, em std::cerr)
+    // --max-erros=N para de registrar erros depois dos N primeiros
+    // --comentarios-aninhados permite { { } } e (* (* *) *)
+    // --ast-plana converte a AST para a representacao plana (flat_ast.hpp) e faz a analise semantica sobre ela
+    // --cache-tokens[=DIR] reaproveita os tokens gravados em DIR para um fonte identico (implica --lote)
+    // --passagem-unica verifica os tipos durante a analise sintatica, sem montar a AST
+    // --comparar-layout mede (com --estatisticas) o percurso dos tokens em TokenStream e em std::vector<Token> (implica --lote)
+    bool estatisticas = false;
+    bool aninhados = false;
+    bool astPlana = false;
+    bool passagemUnica = false;
+    bool compararLayout = false;
+    DiagnosticEngine::Format formato = DiagnosticEngine::Format::TEXT;
+    size_t maxErros = 0;
+    bool lote = false;
+    bool paralelo = false;
+    unsigned threads = 0;
+    std::optional<TokenCache> cache;
+    bool usoInvalido = false;
+    const char* caminho = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--estatisticas") == 0) estatisticas = true;
+        else if (std::strcmp(argv[i], "--lote") == 0) lote = true;
+        else if (std::strcmp(argv[i], "--comentarios-aninhados") == 0) aninhados = true;
+        else if (std::strcmp(argv[i], "--ast-plana") == 0) astPlana = true;
+        else if (std::strcmp(argv[i], "--passagem-unica") == 0) passagemUnica = true;
+        else if (std::strcmp(argv[i], "--comparar-layout") == 0) lote = compararLayout = true;
+        else if (std::strncmp(argv[i], "--paralelo", 10) == 0 && (argv[i][10] == '\0' || argv[i][10] == '=')) {
+            lote = paralelo = true;
+            if (argv[i][10] == '=') threads = static_cast<unsigned>(std::strtoul(argv[i] + 11, nullptr, 10));
+        }
+        else if (std::strncmp(argv[i], "--cache-tokens", 14) == 0 && (argv[i][14] == '\0' || argv[i][14] == '=')) {
+            lote = true;
+            cache.emplace(argv[i][14] == '=' ? argv[i] + 15 : ".cache_tokens");
+        }
+        else if (std::strcmp(argv[i], "--diagnosticos=texto") == 0) formato = DiagnosticEngine::Format::TEXT;
+        else if (std::strcmp(argv[i], "--diagnosticos=json") == 0) formato = DiagnosticEngine::Format::JSON;
+        else if (std::strncmp(argv[i], "--max-erros=", 12) == 0) maxErros = std::strtoul(argv[i] + 12, nullptr, 10);
+        else if (!caminho) caminho = argv[i];
+        else usoInvalido = true;
+    }
+
+    // Sem AST nao ha o que converter para a representacao plana
+    if (passagemUnica && astPlana) usoInvalido = true;
+
+    if(!caminho || usoInvalido){
+        std::cerr << "Uso incorreto. Correto: ./compiler [--estatisticas] [--lote] [--paralelo[=N]] [--diagnosticos=texto|json] [--max-erros=N] [--comentarios-aninhados] [--cache-tokens[=DIR]] [--ast-plana | --passagem-unica] [--comparar-layout] <arquivo_de_codigo.pas>" << std::endl;
         return EXIT_FAILURE;
     }
         
-    std::string conteudo;
-    {
-        std::ifstream arquivo(argv[1]);
-        if (!arquivo.is_open()) {
-            std::cerr << "Erro: Nao foi possivel abrir o arquivo " << argv[1] << std::endl;
-            return EXIT_FAILURE;
-        }
-        std::stringstream conteudoStream;
-        conteudoStream << arquivo.rdbuf();
-        conteudo = conteudoStream.str();
+    // Os arquivos vivem ate o fim da compilacao: os tokens guardam apenas posicoes neles.
+    SourceManager fontes;
+    std::optional<SourceManager::FileId> arquivo = fontes.load(caminho);
+    if (!arquivo) {
+        std::cerr << "Erro: Nao foi possivel abrir o arquivo " << caminho << std::endl;
+        return EXIT_FAILURE;
+    }
+    const std::string_view conteudo = fontes.text(*arquivo);
+    const uint32_t base = fontes.base(*arquivo);
+    Interner simbolos;
+    DiagnosticEngine diagnosticos(fontes);
+    diagnosticos.setErrorLimit(maxErros);
+
+    using Relogio = std::chrono::steady_clock;
+    auto ms = [](Relogio::time_point a, Relogio::time_point b) {
+        return std::chrono::duration<double, std::milli>(b - a).count();
+    };
+
+    // Valida o UTF-8 antes da analise; fora de strings e comentarios os bytes
+    // nao ASCII ainda geram "Caractere inesperado" no lexico.
+    auto tUtf8 = Relogio::now();
+    if (std::optional<size_t> invalido = utf8::firstInvalid(conteudo)) {
+        diagnosticos.report(DiagCode::INVALID_UTF8, base + static_cast<uint32_t>(*invalido));
     }
 
     try {
-        std::cout << "Analise Lexica Iniciada..." << std::endl;
-        Tokenizer tokenizer(std::move(conteudo));
-        std::vector<Token> lista_tokens = tokenizer.tokenize();
-        std::cout << "Analise Lexica Finalizada." << std::endl;
-        
-        std::cout << "Analise Sintatica Iniciada..." << std::endl;
-        Parser parser(lista_tokens);
-        NodePtr ast = parser.parseProgram();
-        std::cout << "Analise Sintatica Finalizada." << std::endl;
+        auto t0 = Relogio::now();
+        Tokenizer tokenizer(conteudo, simbolos, diagnosticos);
+        tokenizer.setNestedComments(aninhados);
+        tokenizer.setLocationBase(base);
+        TokenStream lista_tokens;
+        size_t trechos = 0;
+        size_t rotinas = 0, rotinasParalelas = 0;
+        AstArena arvore; // todos os nos da AST; liberados de uma vez no fim
+        ProgramNode* ast = nullptr;
+        SemanticAnalyzer analyzer(simbolos, diagnosticos);
+        // Fases feitas pelo parser no modo em lote e no modo em fluxo
+        const char* fases = passagemUnica ? "Sintatica e Semantica" : "Sintatica";
+        const char* fasesFluxo = passagemUnica ? "Lexica, Sintatica e Semantica" : "Lexica e Sintatica";
+        Relogio::time_point t1, t2;
+        if (lote) {
+            std::cout << "Analise Lexica Iniciada..." << std::endl;
+            std::optional<TokenCache::Key> chave;
+            std::optional<TokenStream> salvos;
+            if (cache) {
+                chave = TokenCache::keyFor(conteudo, base, aninhados);
+                salvos = cache->load(*chave, simbolos);
+            }
+            if (salvos) {
+                lista_tokens = std::move(*salvos);
+            } else if (paralelo) {
+                ParallelLexer lexer(conteudo, simbolos, diagnosticos, threads);
+                lexer.setNestedComments(aninhados);
+                lexer.setLocationBase(base);
+                lista_tokens = lexer.tokenize();
+                threads = lexer.threads();
+                trechos = lexer.chunks();
+            } else {
+                lista_tokens = tokenizer.tokenizeStream();
+            }
+            // So grava tokens de uma analise sem diagnosticos: num acerto eles nao seriam emitidos de novo
+            if (cache && !salvos && diagnosticos.empty()) cache->store(*chave, lista_tokens, simbolos);
+            t1 = Relogio::now();
+            std::cout << "Analise Lexica Finalizada." << std::endl;
 
-        std::cout << "Analise Semantica Iniciada..." << std::endl;
-        SemanticAnalyzer analyzer;
-        analyzer.analyze(ast);
-        std::cout << "Analise Semantica Finalizada." << std::endl;
+            std::cout << "Analise " << fases << " Iniciada..." << std::endl;
+            if (passagemUnica) {
+                BasicParser<OnePassChecker>(lista_tokens, diagnosticos, OnePassChecker(analyzer)).parseProgram();
+            } else if (paralelo) {
+                ParallelParser parser(lista_tokens, diagnosticos, arvore, threads);
+                ast = parser.parse();
+                threads = parser.threads();
+                rotinas = parser.routines();
+                rotinasParalelas = parser.parsedInParallel();
+            } else {
+                ast = Parser(lista_tokens, diagnosticos, AstBuilder(arvore)).parseProgram();
+            }
+            t2 = Relogio::now();
+            std::cout << "Analise " << fases << " Finalizada." << std::endl;
+        } else {
+            std::cout << "Analise " << fasesFluxo << " Iniciada..." << std::endl;
+            if (passagemUnica) {
+                BasicParser<OnePassChecker>(tokenizer, OnePassChecker(analyzer)).parseProgram();
+            } else {
+                ast = Parser(tokenizer, AstBuilder(arvore)).parseProgram();
+            }
+            t1 = t2 = Relogio::now();
+            std::cout << "Analise " << fasesFluxo << " Finalizada." << std::endl;
+        }
+
+        if (!passagemUnica) std::cout << "Analise Semantica Iniciada..." << std::endl;
+        FlatAst plana;
+        double msPlana = 0;
+        if (astPlana) {
+            auto tp = Relogio::now();
+            plana = FlatAst::flatten(ast);
+            msPlana = ms(tp, Relogio::now());
+            analyzer.analyze(plana);
+        } else if (!passagemUnica) {
+            analyzer.analyze(ast);
+        }
+        auto t3 = Relogio::now();
+        if (!passagemUnica) std::cout << "Analise Semantica Finalizada." << std::endl;
+        diagnosticos.print(std::cerr, formato);
+
+        const size_t nos = arvore.nodes(), usados = arvore.bytesUsed(), reservados = arvore.bytesReserved(), blocos = arvore.blocks();
+        const long pico = peakRssKb();
+        auto t4 = Relogio::now();
+        arvore.clear();
+        ast = nullptr;
+        auto t5 = Relogio::now();
+
+        if (estatisticas) {
+            std::cout << "\nEstatisticas:" << std::endl;
+            std::cout << "  Fonte: " << conteudo.size() << " bytes" << (fontes.hadBom(*arquivo) ? " (BOM UTF-8 removido)" : "") << std::endl;
+            std::cout << "  Validacao UTF-8: " << ms(tUtf8, t0) << " ms" << std::endl;
+            if (lote) {
+                std::cout << "  Tokens: " << lista_tokens.size() << " (" << lista_tokens.totalBytes() << " bytes, "
+                          << lista_tokens.hotBytes() << " no vetor de tipos lido pelo parser)" << std::endl;
+                std::cout << "  Lexica: " << ms(t0, t1) << " ms (" << conteudo.size() / 1000.0 / ms(t0, t1)
+                          << " MB/s, " << ms(t0, t1) * 1e6 / std::max<size_t>(conteudo.size(), 1)
+                          << " ns/byte, varredura " << scan::kernels().name << ")" << std::endl;
+                if (cache) {
+                    std::cout << "  Cache de tokens: " << cache->hits() << " acerto(s), " << cache->misses() << " falta(s), "
+                              << cache->writes() << " gravacao(oes)" << std::endl;
+                }
+                if (paralelo) std::cout << "  Lexica paralela: " << threads << " threads, " << trechos << " trechos" << std::endl;
+                std::cout << "  Sintatica: " << ms(t1, t2) << " ms" << std::endl;
+                if (compararLayout) {
+                    // Mesmos tokens nas duas representacoes; as rodadas se alternam e
+                    // vale a menor de cada, entao o percurso de uma tira a outra do cache.
+                    const size_t n = lista_tokens.size();
+                    std::vector<Token> vetor(n);
+                    for (size_t i = 0; i < n; i++) vetor[i] = lista_tokens.at(i);
+                    double melhorSoa = 0, melhorAos = 0;
+                    uint64_t somaSoa = 0, somaAos = 0;
+                    for (int rodada = 0; rodada < 5; rodada++) {
+                        auto a = Relogio::now();
+                        somaSoa = percorrerTokens(n, [&](size_t i) { return lista_tokens.kind(i); },
+                                                  [&](size_t i) { return lista_tokens.at(i); });
+                        auto b = Relogio::now();
+                        somaAos = percorrerTokens(n, [&](size_t i) { return vetor[i].type; },
+                                                  [&](size_t i) { return vetor[i]; });
+                        auto c = Relogio::now();
+                        if (rodada == 0 || ms(a, b) < melhorSoa) melhorSoa = ms(a, b);
+                        if (rodada == 0 || ms(b, c) < melhorAos) melhorAos = ms(b, c);
+                    }
+                    std::cout << "  Percurso dos tokens: TokenStream " << melhorSoa << " ms (tipos em " << n
+                              << " bytes), std::vector<Token> " << melhorAos << " ms (" << n * sizeof(Token) << " bytes)"
+                              << (somaSoa == somaAos ? "" : " [somas diferentes]") << std::endl;
+                }
+                if (paralelo && !passagemUnica) {
+                    std::cout << "  Sintatica paralela: " << rotinasParalelas << " de " << rotinas << " rotinas nas threads" << std::endl;
+                }
+            } else {
+                std::cout << "  Tokens: " << tokenizer.tokensProduced() << " (janela de " << Tokenizer::LOOKAHEAD
+                          << " tokens, " << Tokenizer::LOOKAHEAD * sizeof(Token) << " bytes)" << std::endl;
+                std::cout << "  Lexica e Sintatica: " << ms(t0, t2) << " ms (varredura " << scan::kernels().name << ")" << std::endl;
+            }
+            if (passagemUnica) {
+                std::cout << "  Semantica: junto com a sintatica (passagem unica, sem AST)" << std::endl;
+            } else {
+                std::cout << "  Semantica: " << ms(t2, t3) << " ms" << (astPlana ? " (AST plana)" : "") << std::endl;
+                std::cout << "  AST: " << nos << " nos, " << usados << " bytes em " << blocos << " blocos da arena ("
+                          << reservados << " reservados), liberada em " << ms(t4, t5) << " ms" << std::endl;
+            }
+            if (astPlana) {
+                std::cout << "  AST plana: " << plana.size() << " nos, " << plana.bytes() << " bytes, convertida em "
+                          << msPlana << " ms" << std::endl;
+            }
+            if (pico) std::cout << "  Pico de memoria (RSS): " << pico << " KB" << std::endl;
+        }
 
         std::cout << "\nCompilacao finalizada com sucesso!" << std::endl;
 
     } catch (const std::runtime_error& e) {
+        diagnosticos.print(std::cerr, formato);
         std::cerr << "Erro fatal durante a compilacao: " << e.what() << std::endl;
         return EXIT_FAILURE;
     }
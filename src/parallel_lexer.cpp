@@ -0,0 +1,147 @@
+#include "parallel_lexer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Trechos menores que isso nao compensam o custo de criar threads
+constexpr size_t MIN_CHUNK = 256 * 1024;
+// Mais trechos que threads equilibra a carga quando os trechos tem custos diferentes
+constexpr size_t CHUNKS_PER_THREAD = 4;
+
+struct Chunk {
+    size_t inicio = 0;
+    size_t fim = 0;
+    std::vector<Token> tokens;
+    std::optional<size_t> pending;
+    std::optional<DiagnosticEngine> diagnostics;
+    Interner symbols;
+};
+
+// Opcoes repassadas a cada Tokenizer
+struct Options {
+    bool nested;
+    uint32_t base;
+};
+
+void lexChunk(std::string_view input, const SourceManager& fontes, Options opcoes, Chunk& chunk) {
+    chunk.diagnostics.emplace(fontes);
+    Tokenizer tokenizer(input, chunk.symbols, *chunk.diagnostics, chunk.inicio, chunk.fim);
+    tokenizer.setNestedComments(opcoes.nested);
+    tokenizer.setLocationBase(opcoes.base);
+    chunk.tokens = tokenizer.tokenize();
+    chunk.pending = tokenizer.pendingFrom();
+}
+
+} // namespace
+
+ParallelLexer::ParallelLexer(std::string_view input, Interner& simbolos, DiagnosticEngine& diagnosticos, unsigned threads)
+    : m_input(input), m_symbols(simbolos), m_diagnostics(diagnosticos), m_threads(threads ? threads : std::max(1u, std::thread::hardware_concurrency())) {}
+
+TokenStream ParallelLexer::tokenize() {
+    // Divide o buffer em trechos que terminam logo apos um '\n'
+    size_t desejados = std::min<size_t>(m_threads * CHUNKS_PER_THREAD, m_input.size() / MIN_CHUNK);
+    if (m_threads == 1) desejados = 1;
+    std::vector<Chunk> chunks;
+    size_t inicio = 0;
+    for (size_t i = 1; i < desejados; i++) {
+        size_t alvo = std::max(inicio, m_input.size() * i / desejados);
+        const void* nl = std::memchr(m_input.data() + alvo, '\n', m_input.size() - alvo);
+        if (!nl) break;
+        size_t fim = static_cast<size_t>(static_cast<const char*>(nl) - m_input.data()) + 1;
+        if (fim >= m_input.size()) break;
+        chunks.emplace_back();
+        chunks.back().inicio = inicio;
+        chunks.back().fim = fim;
+        inicio = fim;
+    }
+    chunks.emplace_back();
+    chunks.back().inicio = inicio;
+    chunks.back().fim = m_input.size();
+    m_chunks = chunks.size();
+    m_repaired = 0;
+
+    // Analisa os trechos em paralelo; a thread atual tambem trabalha
+    const Options opcoes {m_nested, m_base};
+    std::atomic<size_t> proximo {0};
+    auto trabalhador = [&] {
+        for (size_t i = proximo++; i < chunks.size(); i = proximo++) lexChunk(m_input, m_diagnostics.sources(), opcoes, chunks[i]);
+    };
+    std::vector<std::thread> pool;
+    size_t extras = std::min<size_t>(m_threads, chunks.size()) - 1;
+    for (size_t i = 0; i < extras; i++) pool.emplace_back(trabalhador);
+    trabalhador();
+    for (std::thread& t : pool) t.join();
+
+    // Costura: um trecho so e aceito se o anterior terminou fora de comentario/string.
+    // Caso contrario o terminador da construcao pendente e procurado uma unica
+    // vez a partir do inicio dela; os trechos inteiramente dentro dela sao
+    // descartados e so o resto do trecho onde ela termina e reanalisado (de novo
+    // assumindo que comeca fora de comentarios e strings). Assim uma construcao
+    // que cobre k trechos custa uma varredura, e nao k reanalises.
+    struct Aceito {
+        size_t chunk;
+        std::optional<Token> string; // string que atravessou trechos e termina neste
+    };
+    std::vector<Aceito> aceitos;
+    std::optional<Token> string;
+    for (size_t i = 0; i < chunks.size();) {
+        aceitos.push_back({i, string});
+        string.reset();
+        if (!chunks[i].pending || i + 1 == chunks.size()) {
+            i++;
+            continue;
+        }
+
+        const size_t inicio = *chunks[i].pending;
+        Tokenizer busca(m_input, m_symbols, m_diagnostics, inicio, m_input.size());
+        busca.setNestedComments(m_nested);
+        const std::optional<size_t> fimConstrucao = busca.constructEnd(inicio);
+        m_repaired++;
+
+        // Trecho onde a construcao termina. Se ela nao fecha, vai ate o fim do
+        // arquivo: o ultimo trecho e reanalisado a partir dela, o que produz o
+        // token e o diagnostico da string nao terminada.
+        size_t j = chunks.size() - 1;
+        size_t recomeco = inicio;
+        if (fimConstrucao) {
+            j = i + 1;
+            while (chunks[j].fim < *fimConstrucao) j++;
+            recomeco = *fimConstrucao;
+            if (m_input[inicio] == '\'') {
+                string = Token {Tipo_de_token::STRING_LIT, m_base + static_cast<uint32_t>(inicio), static_cast<uint32_t>(recomeco - inicio)};
+            }
+        }
+        for (size_t k = i + 1; k < j; k++) chunks[k] = Chunk(); // cobertos pela construcao
+        const size_t fim = chunks[j].fim;
+        chunks[j] = Chunk();
+        chunks[j].inicio = recomeco;
+        chunks[j].fim = fim;
+        lexChunk(m_input, m_diagnostics.sources(), opcoes, chunks[j]);
+        i = j; // aceito na proxima volta, que tambem trata a construcao em que ele terminar
+    }
+
+    // So os tokens aceitos sao reservados. Os IDs locais de cada trecho sao
+    // traduzidos para o Interner global na ordem do arquivo, reproduzindo a
+    // numeracao da analise sequencial.
+    size_t total = 0;
+    for (const Aceito& a : aceitos) total += chunks[a.chunk].tokens.size() + (a.string ? 1 : 0);
+    TokenStream tokens;
+    tokens.reserve(total);
+    for (const Aceito& a : aceitos) {
+        if (a.string) tokens.push(*a.string);
+        Chunk& atual = chunks[a.chunk];
+        std::vector<uint32_t> global(atual.symbols.size());
+        for (uint32_t id = 0; id < global.size(); id++) global[id] = m_symbols.intern(atual.symbols.name(id));
+        for (Token t : atual.tokens) {
+            if (t.type == Tipo_de_token::IDENTIFIER) t.payload = global[t.symbol()];
+            tokens.push(t);
+        }
+        m_diagnostics.merge(*atual.diagnostics);
+    }
+    return tokens;
+}
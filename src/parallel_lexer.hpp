@@ -0,0 +1,43 @@
+#ifndef PARALLEL_LEXER_HPP
+#define PARALLEL_LEXER_HPP
+
+#include <string_view>
+#include "tokenization.hpp"
+
+// Analise lexica paralela para arquivos grandes.
+// O buffer e dividido em trechos terminados em quebra de linha e cada trecho e
+// analisado por uma thread assumindo que comeca fora de comentarios e strings.
+// Na costura, se um trecho terminou dentro de um comentario ou string, o fim
+// dessa construcao e procurado uma vez; os trechos que ela cobre inteiros sao
+// descartados e o trecho onde ela termina e reanalisado a partir dali. O resultado e
+// identico ao do Tokenizer sequencial, incluindo a ordem dos diagnosticos e os
+// IDs de simbolo: cada trecho usa um Interner e um DiagnosticEngine locais,
+// remapeados/concatenados na costura.
+class ParallelLexer {
+public:
+    // threads == 0 usa std::thread::hardware_concurrency()
+    ParallelLexer(std::string_view input, Interner& simbolos, DiagnosticEngine& diagnosticos, unsigned threads = 0);
+
+    TokenStream tokenize();
+
+    // Repassado a cada Tokenizer (ver Tokenizer::setNestedComments)
+    void setNestedComments(bool ativo) { m_nested = ativo; }
+    // Repassado a cada Tokenizer (ver Tokenizer::setLocationBase)
+    void setLocationBase(uint32_t base) { m_base = base; }
+
+    [[nodiscard]] unsigned threads() const { return m_threads; }
+    [[nodiscard]] size_t chunks() const { return m_chunks; }
+    [[nodiscard]] size_t repairedSeams() const { return m_repaired; }
+
+private:
+    std::string_view m_input;
+    Interner& m_symbols;
+    DiagnosticEngine& m_diagnostics;
+    unsigned m_threads;
+    size_t m_chunks = 0;
+    size_t m_repaired = 0;
+    bool m_nested = false;
+    uint32_t m_base = 0;
+};
+
+#endif
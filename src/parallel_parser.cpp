@@ -0,0 +1,128 @@
+#include "parallel_parser.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <optional>
+#include <thread>
+
+namespace {
+
+// Abaixo disso (tokens somados das rotinas) o custo de criar threads nao compensa
+constexpr size_t MIN_TOKENS = 64 * 1024;
+
+// Estado de cada thread: os nos e os diagnosticos ficam locais ate a costura
+struct Worker {
+    AstArena arena;
+    std::optional<DiagnosticEngine> diagnostics;
+};
+
+bool abreBloco(Tipo_de_token tipo) {
+    return tipo == Tipo_de_token::BEGIN || tipo == Tipo_de_token::CASE || tipo == Tipo_de_token::RECORD ||
+           tipo == Tipo_de_token::TRY;
+}
+
+} // namespace
+
+ParallelParser::ParallelParser(const TokenStream& tokens, DiagnosticEngine& diagnosticos, AstArena& arena, unsigned threads)
+    : m_tokens(tokens), m_diagnostics(diagnosticos), m_arena(arena), m_threads(threads ? threads : std::max(1u, std::thread::hardware_concurrency())) {}
+
+// Trechos [inicio, fim) das rotinas antes do bloco principal, de 'procedure'
+// ou 'function' ate o ';' apos o 'end' do corpo. A varredura para no bloco
+// principal ou em qualquer coisa que nao reconheca (rotinas aninhadas, fim do
+// arquivo); as rotinas seguintes ficam com o Parser sequencial.
+std::vector<ParallelParser::Range> ParallelParser::scan() const {
+    std::vector<Range> trechos;
+    const size_t n = m_tokens.size();
+    size_t i = 0;
+    while (i < n && m_tokens.kind(i) != Tipo_de_token::PROCEDURE && m_tokens.kind(i) != Tipo_de_token::FUNCTION) {
+        if (m_tokens.kind(i) == Tipo_de_token::BEGIN) return trechos;
+        i++;
+    }
+    while (i < n && (m_tokens.kind(i) == Tipo_de_token::PROCEDURE || m_tokens.kind(i) == Tipo_de_token::FUNCTION)) {
+        // Cabecalho e variaveis locais ate o 'begin' do corpo
+        size_t j = i + 1;
+        while (j < n && m_tokens.kind(j) != Tipo_de_token::BEGIN) {
+            if (m_tokens.kind(j) == Tipo_de_token::PROCEDURE || m_tokens.kind(j) == Tipo_de_token::FUNCTION) return trechos;
+            j++;
+        }
+        size_t profundidade = 0;
+        for (; j < n; j++) {
+            const Tipo_de_token tipo = m_tokens.kind(j);
+            if (abreBloco(tipo)) profundidade++;
+            else if (tipo == Tipo_de_token::END && --profundidade == 0) break;
+        }
+        if (j + 1 >= n || m_tokens.kind(j + 1) != Tipo_de_token::SEMICOLON) return trechos;
+        trechos.push_back({i, j + 2});
+        i = j + 2;
+    }
+    return trechos;
+}
+
+ProgramNode* ParallelParser::parse() {
+    const std::vector<Range> trechos = scan();
+    m_routines = trechos.size();
+    m_parallel = 0;
+
+    size_t tokensEmRotinas = 0;
+    for (const Range& r : trechos) tokensEmRotinas += r.fim - r.inicio;
+    const size_t quantas = std::min<size_t>(m_threads, trechos.size());
+
+    Parser principal(m_tokens, m_diagnostics, AstBuilder(m_arena));
+    if (quantas < 2 || tokensEmRotinas < MIN_TOKENS) return principal.parseProgram();
+
+    // Analisa as rotinas em paralelo; a thread atual tambem trabalha. Os nos de
+    // uma rotina que falhou sao liberados na hora, entao a arena de cada thread
+    // guarda so rotinas aceitas, na ordem dos trechos.
+    std::vector<Worker> workers(quantas);
+    std::vector<std::optional<StmtPtr>> resultados(trechos.size());
+    std::vector<size_t> donos(trechos.size());
+    std::vector<AstArena::Mark> fins(trechos.size());
+    std::atomic<size_t> proximo {0};
+    auto trabalhador = [&](size_t indice) {
+        Worker& w = workers[indice];
+        w.diagnostics.emplace(m_diagnostics.sources());
+        for (size_t i = proximo++; i < trechos.size(); i = proximo++) {
+            const AstArena::Mark inicio = w.arena.mark();
+            resultados[i] = Parser(m_tokens, *w.diagnostics, AstBuilder(w.arena), trechos[i].inicio, trechos[i].fim).parseRoutineRange();
+            if (!resultados[i]) {
+                w.arena.rewind(inicio);
+                continue;
+            }
+            donos[i] = indice;
+            fins[i] = w.arena.mark();
+        }
+    };
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < quantas; i++) pool.emplace_back(trabalhador, i);
+    trabalhador(0);
+    for (std::thread& t : pool) t.join();
+
+    // Costura: o Parser sequencial pula os trechos aceitos e reanalisa os que
+    // falharam. Os diagnosticos das threads sao descartados: uma rotina aceita
+    // nao gerou nenhum, e as demais vao emiti-los de novo no Parser sequencial.
+    std::vector<Parser::ParsedRoutine> prontas;
+    std::vector<size_t> origens; // trecho de cada rotina pronta
+    prontas.reserve(trechos.size());
+    origens.reserve(trechos.size());
+    for (size_t i = 0; i < trechos.size(); i++) {
+        if (!resultados[i]) continue;
+        prontas.push_back({trechos[i].inicio, trechos[i].fim, *resultados[i]});
+        origens.push_back(i);
+    }
+    principal.setParsedRoutines(prontas.data(), prontas.size());
+    ProgramNode* programa = principal.parseProgram();
+
+    // Depois de um erro sintatico o Parser sequencial para e as rotinas prontas
+    // seguintes nao entram na arvore: cada arena e cortada no fim da ultima
+    // rotina alcancada dela, e so esse prefixo e adotado pela arena principal.
+    const size_t alcancadas = principal.parsedRoutinesReached();
+    m_parallel = alcancadas;
+    std::vector<std::optional<AstArena::Mark>> cortes(workers.size());
+    for (size_t k = 0; k < alcancadas; k++) cortes[donos[origens[k]]] = fins[origens[k]];
+    for (size_t w = 0; w < workers.size(); w++) {
+        if (!cortes[w]) continue;
+        workers[w].arena.rewind(*cortes[w]);
+        m_arena.adopt(workers[w].arena);
+    }
+    return programa;
+}
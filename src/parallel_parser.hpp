@@ -0,0 +1,47 @@
+#ifndef PARALLEL_PARSER_HPP
+#define PARALLEL_PARSER_HPP
+
+#include <vector>
+#include "parser.hpp"
+
+// Analise sintatica paralela das rotinas de nivel superior (--paralelo).
+// Uma varredura do vetor de tipos casa cada 'procedure'/'function' com o
+// 'end;' do seu corpo (contando begin/case/record/try contra end) e obtem o
+// trecho de tokens de cada rotina. Os trechos sao analisados por threads, cada
+// uma com a sua AstArena e o seu DiagnosticEngine, e as arvores prontas sao
+// entregues ao Parser sequencial, que analisa o resto do programa e as costura
+// no ProgramNode sem reler os tokens delas. A arena principal adota de cada
+// thread apenas os nos das rotinas que entraram na arvore.
+//
+// O resultado e identico ao do Parser sequencial: uma rotina que falhou na sua
+// thread (erro sintatico ou trecho mal delimitado pela varredura) e descartada
+// e analisada de novo pelo Parser sequencial, que emite o diagnostico na ordem
+// de sempre.
+class ParallelParser {
+public:
+    // threads == 0 usa std::thread::hardware_concurrency()
+    ParallelParser(const TokenStream& tokens, DiagnosticEngine& diagnosticos, AstArena& arena, unsigned threads = 0);
+
+    // nullptr se houve erro sintatico, como Parser::parseProgram()
+    ProgramNode* parse();
+
+    [[nodiscard]] unsigned threads() const { return m_threads; }
+    [[nodiscard]] size_t routines() const { return m_routines; }          // trechos encontrados pela varredura
+    [[nodiscard]] size_t parsedInParallel() const { return m_parallel; } // rotinas das threads usadas pelo Parser sequencial
+
+private:
+    struct Range {
+        size_t inicio;
+        size_t fim;
+    };
+    std::vector<Range> scan() const;
+
+    const TokenStream& m_tokens;
+    DiagnosticEngine& m_diagnostics;
+    AstArena& m_arena;
+    unsigned m_threads;
+    size_t m_routines = 0;
+    size_t m_parallel = 0;
+};
+
+#endif
@@ -1,11 +1,14 @@
 #ifndef PARSER_HPP
 #define PARSER_HPP
 
+#include <array>
+#include <optional>
 #include <memory>
 #include <vector>
 #include <string>
 #include <stdexcept>
 #include "tokenization.hpp"
+#include "ast_arena.hpp"
 
 class Node;
 class ExprNode;
@@ -26,39 +29,84 @@ class ProcCallNode;
 class LiteralNode;
 class IdentifierNode;
 class BinaryOpNode;
+class UnaryOpNode;
+class SetNode;
+class FuncCallNode;
+
+// Tipo de cada no, compartilhado pela AST de ponteiros e pela AST plana
+// (flat_ast.hpp). As fases seguintes inspecionam os nos com um switch sobre
+// esta etiqueta, sem RTTI.
+enum class AstKind : uint8_t {
+    PROGRAM, VAR_SECTION, VAR_DECL, ROUTINE, BLOCK, IF, WHILE, FOR, REPEAT, ASSIGN, PROC_CALL,
+    LITERAL, IDENTIFIER, BINARY_OP, UNARY_OP, SET, FUNC_CALL,
+};
 
-class Node { public: virtual ~Node() = default; };
-using NodePtr = std::unique_ptr<Node>;
+// Os nos sao alocados na AstArena da compilacao e liberados todos juntos com
+// ela; os filhos sao ponteiros simples e as listas sao ArenaSpan.
+class Node {
+public:
+    const AstKind kind;
+protected:
+    explicit Node(AstKind k) : kind(k) {}
+};
+using NodePtr = Node*;
 
 
-class ExprNode : public Node { public: virtual ~ExprNode() = default; };
-using ExprPtr = std::unique_ptr<ExprNode>;
+class ExprNode : public Node { protected: using Node::Node; };
+using ExprPtr = ExprNode*;
 
-class StmtNode : public Node { public: virtual ~StmtNode() = default; };
-using StmtPtr = std::unique_ptr<StmtNode>;
+class StmtNode : public Node { protected: using Node::Node; };
+using StmtPtr = StmtNode*;
 
 
 class ProgramNode : public Node {
 public:
     Token name;
     StmtPtr vars;
+    ArenaSpan<const StmtPtr> routines; // FunctionDeclNode, na ordem do fonte
     StmtPtr mainBlock;
-    ProgramNode(Token n, StmtPtr v, StmtPtr m)
-      : name(std::move(n)), vars(std::move(v)), mainBlock(std::move(m)) {}
+    ProgramNode(Token n, StmtPtr v, ArenaSpan<const StmtPtr> r, StmtPtr m)
+      : Node(AstKind::PROGRAM), name(n), vars(v), routines(r), mainBlock(m) {}
+};
+
+// Uma variavel declarada e o token do seu tipo
+struct VarEntry {
+    Token name;
+    Token type;
+};
+
+// Parametro de uma rotina; 'byRef' para os declarados com 'var'
+struct ParamEntry {
+    Token name;
+    Token type;
+    bool byRef;
+};
+
+// Nó para um procedimento ou funcao
+class FunctionDeclNode : public StmtNode {
+public:
+    Token name;
+    bool isFunction;
+    Token resultType; // so em funcoes
+    ArenaSpan<const ParamEntry> params;
+    StmtPtr vars;
+    StmtPtr body;
+    FunctionDeclNode(Token n, bool f, Token r, ArenaSpan<const ParamEntry> p, StmtPtr v, StmtPtr b)
+      : StmtNode(AstKind::ROUTINE), name(n), isFunction(f), resultType(r), params(p), vars(v), body(b) {}
 };
 
 // Nó para a seção VAR
 class VarSectionNode : public StmtNode {
 public:
-    std::vector<std::pair<Token, Token>> entries;
-    VarSectionNode(std::vector<std::pair<Token, Token>> e) : entries(std::move(e)) {}
+    ArenaSpan<const VarEntry> entries;
+    VarSectionNode(ArenaSpan<const VarEntry> e) : StmtNode(AstKind::VAR_SECTION), entries(e) {}
 };
 
 // Nó para um bloco BEGIN...END
 class BlockNode : public StmtNode {
 public:
-    std::vector<StmtPtr> statements;
-    BlockNode(std::vector<StmtPtr> stmts) : statements(std::move(stmts)) {}
+    ArenaSpan<const StmtPtr> statements;
+    BlockNode(ArenaSpan<const StmtPtr> stmts) : StmtNode(AstKind::BLOCK), statements(stmts) {}
 };
 
 // Nó para o comando IF-THEN-ELSE
@@ -67,7 +115,7 @@ public:
     ExprPtr cond;
     StmtPtr thenBr;
     StmtPtr elseBr;
-    IfNode(ExprPtr c, StmtPtr t, StmtPtr e) : cond(std::move(c)), thenBr(std::move(t)), elseBr(std::move(e)) {}
+    IfNode(ExprPtr c, StmtPtr t, StmtPtr e) : StmtNode(AstKind::IF), cond(c), thenBr(t), elseBr(e) {}
 };
 
 // Nó para o laço WHILE
@@ -75,7 +123,7 @@ class WhileNode : public StmtNode {
 public:
     ExprPtr cond;
     StmtPtr body;
-    WhileNode(ExprPtr c, StmtPtr b) : cond(std::move(c)), body(std::move(b)) {}
+    WhileNode(ExprPtr c, StmtPtr b) : StmtNode(AstKind::WHILE), cond(c), body(b) {}
 };
 
 // Nó para o laço FOR
@@ -86,15 +134,15 @@ public:
     ExprPtr end;
     bool toUp;
     StmtPtr body;
-    ForNode(Token v, ExprPtr s, ExprPtr e, bool u, StmtPtr b) : var(std::move(v)), start(std::move(s)), end(std::move(e)), toUp(u), body(std::move(b)) {}
+    ForNode(Token v, ExprPtr s, ExprPtr e, bool u, StmtPtr b) : StmtNode(AstKind::FOR), var(v), start(s), end(e), toUp(u), body(b) {}
 };
 
 // Nó para o laço REPEAT...UNTIL
 class RepeatNode : public StmtNode {
 public:
-    std::vector<StmtPtr> body;
+    ArenaSpan<const StmtPtr> body;
     ExprPtr cond;
-    RepeatNode(std::vector<StmtPtr> b, ExprPtr c) : body(std::move(b)), cond(std::move(c)) {}
+    RepeatNode(ArenaSpan<const StmtPtr> b, ExprPtr c) : StmtNode(AstKind::REPEAT), body(b), cond(c) {}
 };
 
 // Nó para o comando de atribuição
@@ -102,21 +150,29 @@ class AssignNode : public StmtNode {
 public:
     Token target;
     ExprPtr value;
-    AssignNode(Token t, ExprPtr v) : target(std::move(t)), value(std::move(v)) {}
+    AssignNode(Token t, ExprPtr v) : StmtNode(AstKind::ASSIGN), target(t), value(v) {}
+};
+
+// Nó para a chamada de um procedimento
+class ProcCallNode : public StmtNode {
+public:
+    Token name;
+    ArenaSpan<const ExprPtr> args;
+    ProcCallNode(Token n, ArenaSpan<const ExprPtr> a) : StmtNode(AstKind::PROC_CALL), name(n), args(a) {}
 };
 
 // Nó para um valor literal
 class LiteralNode : public ExprNode {
 public:
     Token value;
-    LiteralNode(Token v) : value(std::move(v)) {}
+    LiteralNode(Token v) : ExprNode(AstKind::LITERAL), value(v) {}
 };
 
 // Nó para um identificador (uso de uma variável)
 class IdentifierNode : public ExprNode {
 public:
     Token identifier;
-    IdentifierNode(Token id) : identifier(std::move(id)) {}
+    IdentifierNode(Token id) : ExprNode(AstKind::IDENTIFIER), identifier(id) {}
 };
 
 class BinaryOpNode : public ExprNode {
@@ -124,73 +180,331 @@ public:
     ExprPtr left;
     Token op;
     ExprPtr right;
-    BinaryOpNode(ExprPtr l, Token o, ExprPtr r) : left(std::move(l)), op(std::move(o)), right(std::move(r)) {}
+    BinaryOpNode(ExprPtr l, Token o, ExprPtr r) : ExprNode(AstKind::BINARY_OP), left(l), op(o), right(r) {}
 };
 
+// Nó para um operador prefixado (NOT, + e - unarios)
+class UnaryOpNode : public ExprNode {
+public:
+    Token op;
+    ExprPtr operand;
+    UnaryOpNode(Token o, ExprPtr e) : ExprNode(AstKind::UNARY_OP), op(o), operand(e) {}
+};
+
+// Nó para um construtor de conjunto [e1, e2, ...]
+class SetNode : public ExprNode {
+public:
+    Token open;
+    ArenaSpan<const ExprPtr> elements;
+    SetNode(Token o, ArenaSpan<const ExprPtr> e) : ExprNode(AstKind::SET), open(o), elements(e) {}
+};
 
-class Parser {
+// Nó para a chamada de uma funcao dentro de uma expressao
+class FuncCallNode : public ExprNode {
 public:
-    Parser(const std::vector<Token>& toks) : tokens(toks), pos(0) {}
+    Token name;
+    ArenaSpan<const ExprPtr> args;
+    FuncCallNode(Token n, ArenaSpan<const ExprPtr> a) : ExprNode(AstKind::FUNC_CALL), name(n), args(a) {}
+};
 
-    std::unique_ptr<ProgramNode> parseProgram() {
+// Poder de ligacao dos operadores, indexado por Tipo_de_token e consultado
+// pelo laco Pratt de Parser::parseExpression. 'infixo' e o nivel do operador
+// binario (0 = o token nao continua uma expressao); 'prefixo' e o nivel minimo
+// do operando de um operador unario (0 = nao e prefixo). O sinal e NOT se
+// aplicam apenas ao fator seguinte: a * -b div c = (a * (-b)) div c.
+namespace precedence {
+
+constexpr uint8_t RELACIONAL = 1;     // = <> < > <= >= in
+constexpr uint8_t ADITIVO = 2;        // + - or
+constexpr uint8_t MULTIPLICATIVO = 3; // * / div mod and
+constexpr uint8_t FATOR = 4;          // operando de not e do sinal
+
+struct Entry {
+    uint8_t infixo = 0;
+    uint8_t prefixo = 0;
+};
+
+constexpr size_t TIPOS = static_cast<size_t>(Tipo_de_token::COLON) + 1;
+
+constexpr std::array<Entry, TIPOS> build() {
+    std::array<Entry, TIPOS> t {};
+    auto infixo = [&t](Tipo_de_token tipo, uint8_t nivel) { t[static_cast<size_t>(tipo)].infixo = nivel; };
+    auto prefixo = [&t](Tipo_de_token tipo, uint8_t nivel) { t[static_cast<size_t>(tipo)].prefixo = nivel; };
+    for (Tipo_de_token tipo : {Tipo_de_token::EQUAL, Tipo_de_token::NOT_EQUAL, Tipo_de_token::LESS, Tipo_de_token::GREATER,
+                               Tipo_de_token::LESS_EQUAL, Tipo_de_token::GREATER_EQUAL, Tipo_de_token::IN}) {
+        infixo(tipo, RELACIONAL);
+    }
+    for (Tipo_de_token tipo : {Tipo_de_token::PLUS, Tipo_de_token::MINUS, Tipo_de_token::OR}) infixo(tipo, ADITIVO);
+    for (Tipo_de_token tipo : {Tipo_de_token::MULTIPLY, Tipo_de_token::DIVIDE, Tipo_de_token::DIV, Tipo_de_token::MOD, Tipo_de_token::AND}) {
+        infixo(tipo, MULTIPLICATIVO);
+    }
+    prefixo(Tipo_de_token::PLUS, FATOR);
+    prefixo(Tipo_de_token::MINUS, FATOR);
+    prefixo(Tipo_de_token::NOT, FATOR);
+    return t;
+}
+
+constexpr std::array<Entry, TIPOS> TABLE = build();
+
+constexpr const Entry& of(Tipo_de_token tipo) { return TABLE[static_cast<size_t>(tipo)]; }
+
+} // namespace precedence
+
+// Interrompe a analise sintatica; o erro ja foi registrado no DiagnosticEngine.
+class SyntaxError : public std::runtime_error {
+public:
+    SyntaxError() : std::runtime_error("Erro sintatico") {}
+};
+
+// Cabecalho de uma rotina ja lido, entregue ao Sink antes do corpo
+struct RoutineHeader {
+    Token name;
+    bool isFunction;
+    Token resultType; // so em funcoes
+    const ParamEntry* params;
+    size_t paramCount;
+};
+
+// Acoes semanticas do parser. O BasicParser reconhece a gramatica e chama o
+// Sink a cada construcao completa; o Sink decide o que ela produz. Expr, Stmt
+// e Program sao os valores que o parser passa adiante (AstBuilder: nos da
+// AST). Os ganchos sem valor (beginAssign, forControl, ...) marcam pontos
+// intermediarios de uma construcao, para quem precisa agir antes do resto
+// dela ser lido (ver OnePassChecker em analisador_semantico.hpp).
+//
+// AstBuilder: monta a AST de ponteiros na arena.
+class AstBuilder {
+public:
+    using Expr = ExprPtr;
+    using Stmt = StmtPtr;
+    using Program = ProgramNode*;
+
+    explicit AstBuilder(AstArena& arena) : m_arena(arena) {}
+
+    Expr literal(const Token& t) { return m_arena.make<LiteralNode>(t); }
+    Expr identifier(const Token& t) { return m_arena.make<IdentifierNode>(t); }
+    Expr unary(const Token& op, Expr operand) { return m_arena.make<UnaryOpNode>(op, operand); }
+    Expr binary(Expr left, const Token& op, Expr right) { return m_arena.make<BinaryOpNode>(left, op, right); }
+    Expr set(const Token& open, const Expr* elementos, size_t n) {
+        return m_arena.make<SetNode>(open, m_arena.copy<const ExprPtr>(elementos, n));
+    }
+    Expr funcCall(const Token& name, const Expr* args, size_t n) {
+        return m_arena.make<FuncCallNode>(name, m_arena.copy<const ExprPtr>(args, n));
+    }
+
+    Stmt varSection(const VarEntry* entradas, size_t n) {
+        return m_arena.make<VarSectionNode>(m_arena.copy<const VarEntry>(entradas, n));
+    }
+    Stmt block(const Stmt* comandos, size_t n) { return m_arena.make<BlockNode>(m_arena.copy<const StmtPtr>(comandos, n)); }
+    void beginAssign(const Token&) {}
+    Stmt assign(const Token& target, Expr value) { return m_arena.make<AssignNode>(target, value); }
+    Expr ifCondition(Expr cond) { return cond; }
+    Stmt ifStmt(Expr cond, Stmt thenBr, Stmt elseBr) { return m_arena.make<IfNode>(cond, thenBr, elseBr); }
+    Expr whileCondition(Expr cond) { return cond; }
+    Stmt whileStmt(Expr cond, Stmt body) { return m_arena.make<WhileNode>(cond, body); }
+    void forControl(const Token&) {}
+    Expr forStart(const Token&, Expr start) { return start; }
+    Expr forEnd(const Token&, Expr end) { return end; }
+    Stmt forStmt(const Token& var, Expr start, Expr end, bool toUp, Stmt body) {
+        return m_arena.make<ForNode>(var, start, end, toUp, body);
+    }
+    Stmt repeatStmt(const Stmt* comandos, size_t n, Expr cond) {
+        return m_arena.make<RepeatNode>(m_arena.copy<const StmtPtr>(comandos, n), cond);
+    }
+    Stmt procCall(const Token& name, const Expr* args, size_t n) {
+        return m_arena.make<ProcCallNode>(name, m_arena.copy<const ExprPtr>(args, n));
+    }
+    void beginRoutine(const RoutineHeader&) {}
+    Stmt routine(const RoutineHeader& h, Stmt vars, Stmt body) {
+        return m_arena.make<FunctionDeclNode>(h.name, h.isFunction, h.resultType, m_arena.copy<const ParamEntry>(h.params, h.paramCount), vars, body);
+    }
+    Program program(const Token& name, Stmt vars, const Stmt* rotinas, size_t n, Stmt mainBlock) {
+        return m_arena.make<ProgramNode>(name, vars, m_arena.copy<const StmtPtr>(rotinas, n), mainBlock);
+    }
+
+private:
+    AstArena& m_arena;
+};
+
+template <class Sink>
+class BasicParser {
+public:
+    using Expr = typename Sink::Expr;
+    using Stmt = typename Sink::Stmt;
+    using Program = typename Sink::Program;
+
+    // Modo em lote: consome uma sequencia de tokens ja produzida.
+    BasicParser(const TokenStream& toks, DiagnosticEngine& diagnosticos, Sink acoes)
+        : diagnostics(diagnosticos), sink(acoes), tokens(&toks), stream(nullptr), pos(0), limit(toks.size()) {}
+    // Apenas os tokens [inicio, fim): o fim do trecho e tratado como fim do arquivo.
+    BasicParser(const TokenStream& toks, DiagnosticEngine& diagnosticos, Sink acoes, size_t inicio, size_t fim)
+        : diagnostics(diagnosticos), sink(acoes), tokens(&toks), stream(nullptr), pos(inicio), limit(fim) {}
+    BasicParser(const std::vector<Token>& toks, DiagnosticEngine& diagnosticos, Sink acoes)
+        : diagnostics(diagnosticos), sink(acoes), owned(toks), tokens(&owned), stream(nullptr), pos(0), limit(owned.size()) {}
+    // Modo em fluxo: puxa os tokens do Tokenizer conforme a analise avanca.
+    BasicParser(Tokenizer& fluxo, Sink acoes) : diagnostics(fluxo.diagnostics()), sink(acoes), tokens(nullptr), stream(&fluxo), pos(0), limit(0) {}
+
+    // Valor vazio de Program (nullptr no AstBuilder) se houve erro sintatico
+    Program parseProgram() {
         try {
             return program();
-        } catch (const std::runtime_error& e) {
-            std::cerr << e.what() << std::endl;
-            return nullptr;
+        } catch (const SyntaxError&) {
+            return Program {};
+        }
+    }
+
+    // Rotina ja analisada em outro lugar (ParallelParser): ocupa os tokens [inicio, fim).
+    struct ParsedRoutine {
+        size_t inicio;
+        size_t fim;
+        Stmt routine;
+    };
+    // Modo em lote: ao chegar no primeiro token de uma dessas rotinas (ordenadas
+    // por 'inicio'), o parser usa o resultado e pula o trecho. As demais sao
+    // analisadas normalmente.
+    void setParsedRoutines(const ParsedRoutine* rotinas, size_t n) {
+        parsedBegin = parsed = rotinas;
+        parsedEnd = rotinas + n;
+    }
+    // Quantas rotinas de setParsedRoutines() o parser ja alcancou, usadas ou
+    // puladas; menos que todas se a analise parou num erro sintatico
+    [[nodiscard]] size_t parsedRoutinesReached() const { return static_cast<size_t>(parsed - parsedBegin); }
+
+    // Analisa uma rotina que ocupa exatamente o trecho do parser; vazio se houve
+    // erro sintatico ou se sobraram tokens no trecho.
+    std::optional<Stmt> parseRoutineRange() {
+        try {
+            Stmt rotina = parseRoutine();
+            if (has()) return std::nullopt;
+            return rotina;
+        } catch (const SyntaxError&) {
+            return std::nullopt;
         }
     }
 
 private:
-    const std::vector<Token>& tokens;
+    DiagnosticEngine& diagnostics;
+    Sink sink;
+    TokenStream owned;
+    const TokenStream* tokens;
+    Tokenizer* stream;
     size_t pos;
+    size_t limit; // fim dos tokens visiveis no modo em lote
+    uint32_t lastStreamOffset = DiagnosticEngine::NO_OFFSET; // modo em fluxo: o token ja saiu da janela
+    const ParsedRoutine* parsedBegin = nullptr;
+    const ParsedRoutine* parsed = nullptr;
+    const ParsedRoutine* parsedEnd = nullptr;
+    // Pilha de comandos dos blocos abertos; ao fechar um bloco os seus comandos
+    // sao entregues ao Sink e removidos do topo, sem um vetor por bloco.
+    std::vector<Stmt> pendingStmts;
+    std::vector<Expr> pendingExprs; // elementos dos conjuntos e argumentos das chamadas abertas
+
+    // A descida recursiva usa a pilha nativa: comandos e expressoes aninhados
+    // alem de MAX_NESTING niveis sao rejeitados com um diagnostico em vez de
+    // estourar a pilha. Cadeias como 1+1+1+... sao lidas pelo laco de
+    // parseExpression e nao contam como aninhamento.
+    static constexpr unsigned MAX_NESTING = 2000;
+    unsigned depth = 0;
+
+    class Nesting {
+    public:
+        explicit Nesting(BasicParser& p) : parser(p) {
+            if (++parser.depth > MAX_NESTING) {
+                parser.depth--;
+                // No fim do arquivo o erro aponta para o ultimo token lido
+                parser.fail(DiagCode::NESTING_TOO_DEEP, parser.has() ? parser.tokenAt().offset : parser.lastOffset(),
+                            {std::to_string(MAX_NESTING)});
+            }
+        }
+        ~Nesting() { parser.depth--; }
+        Nesting(const Nesting&) = delete;
+        Nesting& operator=(const Nesting&) = delete;
+    private:
+        BasicParser& parser;
+    };
+
+    bool has(size_t offset = 0) {
+        if (stream) return stream->peek(offset) != nullptr;
+        return pos + offset < limit;
+    }
+    // Tipo do token 'offset' posicoes a frente; no modo em lote le apenas o vetor de tipos.
+    Tipo_de_token kindAt(size_t offset = 0) {
+        if (stream) return stream->peek(offset)->type;
+        return tokens->kind(pos + offset);
+    }
+    Token tokenAt(size_t offset = 0) {
+        if (stream) return *stream->peek(offset);
+        return tokens->at(pos + offset);
+    }
+    void skip() {
+        if (stream) lastStreamOffset = stream->next()->offset;
+        else pos++;
+    }
+    // Posicao do ultimo token consumido (NO_OFFSET se nenhum foi)
+    uint32_t lastOffset() {
+        if (stream) return lastStreamOffset;
+        return pos > 0 ? tokens->at(pos - 1).offset : DiagnosticEngine::NO_OFFSET;
+    }
+
+    [[noreturn]] void fail(DiagCode code, uint32_t offset, std::initializer_list<std::string_view> args = {}) {
+        diagnostics.report(code, offset, args);
+        throw SyntaxError();
+    }
 
-    const Token& peek(int offset = 0) const {
-        if (pos + offset >= tokens.size()) throw std::runtime_error("Fim inesperado do arquivo.");
-        return tokens[pos + offset];
+    Tipo_de_token peekType(int offset = 0) {
+        if (!has(offset)) fail(DiagCode::UNEXPECTED_EOF, DiagnosticEngine::NO_OFFSET);
+        return kindAt(offset);
     }
-    const Token& advance() {
-        if (pos >= tokens.size()) throw std::runtime_error("Fim inesperado do arquivo ao avancar.");
-        return tokens[pos++];
+    Token peek(int offset = 0) {
+        if (!has(offset)) fail(DiagCode::UNEXPECTED_EOF, DiagnosticEngine::NO_OFFSET);
+        return tokenAt(offset);
+    }
+    Token advance() {
+        if (!has()) fail(DiagCode::UNEXPECTED_EOF, DiagnosticEngine::NO_OFFSET);
+        Token tok = tokenAt();
+        skip();
+        return tok;
     }
     bool match(Tipo_de_token type) {
-        if (pos >= tokens.size() || tokens[pos].type != type) return false;
-        pos++;
+        if (!has() || kindAt() != type) return false;
+        skip();
         return true;
     }
-    const Token& expect(Tipo_de_token type, const std::string& msg) {
-        if (pos >= tokens.size() || tokens[pos].type != type) {
-            std::string errmsg = "Erro sintatico: " + msg;
-            if(pos < tokens.size()){
-                errmsg += " (esperado '" + TokenTypeToString(type) + "', encontrado '" + TokenTypeToString(peek().type) + "' na linha " + std::to_string(peek().line) + ")";
-            }
-            throw std::runtime_error(errmsg);
+    Token expect(Tipo_de_token type, const std::string& msg) {
+        if (!has() || kindAt() != type) {
+            if (!has()) fail(DiagCode::EXPECTED_AT_EOF, DiagnosticEngine::NO_OFFSET, {msg});
+            fail(DiagCode::EXPECTED_TOKEN, tokenAt().offset, {msg, TokenTypeToString(type), TokenTypeToString(kindAt())});
         }
-        return tokens[pos++];
+        Token tok = tokenAt();
+        skip();
+        return tok;
     }
 
     // Métodos de parsing para cada regra da gramática
-    std::unique_ptr<ProgramNode> program();
-    StmtPtr parseVarDecl();
-    StmtPtr parseBlock();
-    StmtPtr parseStatement();
-    StmtPtr parseIf();
-    StmtPtr parseWhile();
-    StmtPtr parseFor();
-    StmtPtr parseRepeat();
-    StmtPtr parseAssignment();
-
-    ExprPtr parseExpression();
-    ExprPtr parseRelational();
-    ExprPtr parseAdditive();
-    ExprPtr parseMultiplicative();
-    ExprPtr parsePrimary();
+    Program program();
+    Stmt parseVarDecl();
+    Stmt parseRoutine();
+    Stmt parseProcCall();
+    void parseArguments();
+    Stmt parseBlock();
+    Stmt parseStatement();
+    Stmt parseIf();
+    Stmt parseWhile();
+    Stmt parseFor();
+    Stmt parseRepeat();
+    Stmt parseAssignment();
+
+    Expr parseExpression(uint8_t minimo = precedence::RELACIONAL);
+    Expr parsePrefix();
+    Expr parsePrimary();
+    Expr parseSet();
 
     std::string TokenTypeToString(Tipo_de_token type); 
 };
 
 
-inline std::string Parser::TokenTypeToString(Tipo_de_token type) {
+template <class Sink>
+std::string BasicParser<Sink>::TokenTypeToString(Tipo_de_token type) {
     switch (type) {
         case Tipo_de_token::PROGRAM: return "PROGRAM"; case Tipo_de_token::VAR: return "VAR";
         case Tipo_de_token::BEGIN: return "BEGIN"; case Tipo_de_token::END: return "END";
@@ -201,26 +515,85 @@ inline std::string Parser::TokenTypeToString(Tipo_de_token type) {
     }
 }
 
-inline std::unique_ptr<ProgramNode> Parser::program() {
+template <class Sink>
+auto BasicParser<Sink>::program() -> Program {
     expect(Tipo_de_token::PROGRAM, "Esperado 'program' no inicio do arquivo.");
     Token name = expect(Tipo_de_token::IDENTIFIER, "Esperado nome do programa.");
     expect(Tipo_de_token::SEMICOLON, "Esperado ';' apos nome do programa.");
     
-    StmtPtr vars = nullptr;
-    if (peek().type == Tipo_de_token::VAR) {
+    Stmt vars {};
+    if (peekType() == Tipo_de_token::VAR) {
         vars = parseVarDecl();
     }
+
+    const size_t inicio = pendingStmts.size();
+    while (peekType() == Tipo_de_token::PROCEDURE || peekType() == Tipo_de_token::FUNCTION) {
+        Stmt rotina = parseRoutine();
+        pendingStmts.push_back(rotina);
+    }
     
     auto mainBlock = parseBlock();
     expect(Tipo_de_token::DOT, "Esperado '.' no fim do programa.");
     
-    return std::make_unique<ProgramNode>(name, std::move(vars), std::move(mainBlock));
+    Program programa = sink.program(name, vars, pendingStmts.data() + inicio, pendingStmts.size() - inicio, mainBlock);
+    pendingStmts.resize(inicio);
+    return programa;
+}
+
+template <class Sink>
+auto BasicParser<Sink>::parseRoutine() -> Stmt {
+    if (!stream) {
+        while (parsed != parsedEnd && parsed->inicio < pos) parsed++;
+        if (parsed != parsedEnd && parsed->inicio == pos) {
+            pos = parsed->fim;
+            return (parsed++)->routine;
+        }
+    }
+
+    const bool funcao = advance().type == Tipo_de_token::FUNCTION;
+    Token name = expect(Tipo_de_token::IDENTIFIER, "Esperado nome da rotina.");
+    std::vector<ParamEntry> params;
+    if (match(Tipo_de_token::OPEN_PAREN)) {
+        if (peekType() != Tipo_de_token::CLOSE_PAREN) {
+            do {
+                const bool porReferencia = match(Tipo_de_token::VAR);
+                std::vector<Token> idList;
+                idList.push_back(expect(Tipo_de_token::IDENTIFIER, "Esperado nome do parametro."));
+                while (match(Tipo_de_token::COMMA)) {
+                    idList.push_back(expect(Tipo_de_token::IDENTIFIER, "Esperado nome do parametro apos a virgula."));
+                }
+                expect(Tipo_de_token::COLON, "Esperado ':' apos os nomes dos parametros.");
+                Token type = advance();
+                for (const auto& id : idList) {
+                    params.push_back({id, type, porReferencia});
+                }
+            } while (match(Tipo_de_token::SEMICOLON));
+        }
+        expect(Tipo_de_token::CLOSE_PAREN, "Esperado ')' apos os parametros.");
+    }
+    Token resultado {};
+    if (funcao) {
+        expect(Tipo_de_token::COLON, "Esperado ':' antes do tipo de retorno da funcao.");
+        resultado = advance();
+    }
+    expect(Tipo_de_token::SEMICOLON, "Esperado ';' apos o cabecalho da rotina.");
+
+    const RoutineHeader cabecalho {name, funcao, resultado, params.data(), params.size()};
+    sink.beginRoutine(cabecalho);
+    Stmt vars {};
+    if (peekType() == Tipo_de_token::VAR) {
+        vars = parseVarDecl();
+    }
+    auto body = parseBlock();
+    expect(Tipo_de_token::SEMICOLON, "Esperado ';' apos o 'end' da rotina.");
+    return sink.routine(cabecalho, vars, body);
 }
 
-inline StmtPtr Parser::parseVarDecl() {
+template <class Sink>
+auto BasicParser<Sink>::parseVarDecl() -> Stmt {
     expect(Tipo_de_token::VAR, "Esperado 'var'.");
-    std::vector<std::pair<Token, Token>> entries;
-    while (peek().type == Tipo_de_token::IDENTIFIER) {
+    std::vector<VarEntry> entries;
+    while (peekType() == Tipo_de_token::IDENTIFIER) {
         std::vector<Token> idList;
         idList.push_back(expect(Tipo_de_token::IDENTIFIER, "Esperado identificador."));
         while (match(Tipo_de_token::COMMA)) {
@@ -231,32 +604,42 @@ inline StmtPtr Parser::parseVarDecl() {
         expect(Tipo_de_token::SEMICOLON, "Esperado ';' apos a declaracao de tipo.");
         
         for (const auto& id : idList) {
-            entries.emplace_back(id, type);
+            entries.push_back({id, type});
         }
     }
-    return std::make_unique<VarSectionNode>(std::move(entries));
+    return sink.varSection(entries.data(), entries.size());
 }
 
 
-inline StmtPtr Parser::parseBlock() {
+template <class Sink>
+auto BasicParser<Sink>::parseBlock() -> Stmt {
     expect(Tipo_de_token::BEGIN, "Esperado 'begin' para iniciar um bloco.");
-    std::vector<StmtPtr> stmts;
-    while (peek().type != Tipo_de_token::END) {
-        stmts.push_back(parseStatement());
+    const size_t inicio = pendingStmts.size();
+    while (peekType() != Tipo_de_token::END) {
+        Stmt stmt = parseStatement();
+        pendingStmts.push_back(stmt);
     }
     expect(Tipo_de_token::END, "Esperado 'end' para finalizar um bloco.");
-    return std::make_unique<BlockNode>(std::move(stmts));
+    Stmt bloco = sink.block(pendingStmts.data() + inicio, pendingStmts.size() - inicio);
+    pendingStmts.resize(inicio);
+    return bloco;
 }
 
-inline StmtPtr Parser::parseStatement() {
-    StmtPtr stmt;
-    switch(peek().type) {
+template <class Sink>
+auto BasicParser<Sink>::parseStatement() -> Stmt {
+    Nesting guarda(*this);
+    Stmt stmt {};
+    switch(peekType()) {
         case Tipo_de_token::BEGIN:
             stmt = parseBlock();
             expect(Tipo_de_token::SEMICOLON, "Esperado ';' apos o bloco 'end'.");
             break;
         case Tipo_de_token::IDENTIFIER:
-            stmt = parseAssignment();
+            if (has(1) && (kindAt(1) == Tipo_de_token::SEMICOLON || kindAt(1) == Tipo_de_token::OPEN_PAREN)) {
+                stmt = parseProcCall();
+            } else {
+                stmt = parseAssignment();
+            }
             break;
         case Tipo_de_token::IF:
             stmt = parseIf();
@@ -271,115 +654,181 @@ inline StmtPtr Parser::parseStatement() {
             stmt = parseRepeat();
             break;
         default:
-            throw std::runtime_error("Comando invalido ou inesperado na linha " + std::to_string(peek().line));
+            fail(DiagCode::INVALID_STATEMENT, peek().offset);
     }
     return stmt;
 }
 
-inline StmtPtr Parser::parseAssignment() {
+template <class Sink>
+auto BasicParser<Sink>::parseAssignment() -> Stmt {
     Token target = expect(Tipo_de_token::IDENTIFIER, "Esperado identificador para atribuicao.");
     expect(Tipo_de_token::ASSIGN, "Esperado ':=' para atribuicao.");
+    sink.beginAssign(target);
     auto value = parseExpression();
     expect(Tipo_de_token::SEMICOLON, "Esperado ';' no final do comando de atribuicao.");
-    return std::make_unique<AssignNode>(target, std::move(value));
+    return sink.assign(target, value);
 }
 
-inline ExprPtr Parser::parseExpression() {
-    return parseRelational();
+// Chamada de procedimento como comando: nome [ '(' argumentos ')' ] ';'
+template <class Sink>
+auto BasicParser<Sink>::parseProcCall() -> Stmt {
+    Token name = advance();
+    const size_t inicio = pendingExprs.size();
+    if (match(Tipo_de_token::OPEN_PAREN)) parseArguments();
+    expect(Tipo_de_token::SEMICOLON, "Esperado ';' apos a chamada de procedimento.");
+    Stmt chamada = sink.procCall(name, pendingExprs.data() + inicio, pendingExprs.size() - inicio);
+    pendingExprs.resize(inicio);
+    return chamada;
 }
 
-inline ExprPtr Parser::parseRelational() {
-    auto left = parseAdditive();
-    while (peek().type == Tipo_de_token::EQUAL || peek().type == Tipo_de_token::NOT_EQUAL ||
-           peek().type == Tipo_de_token::LESS || peek().type == Tipo_de_token::GREATER ||
-           peek().type == Tipo_de_token::LESS_EQUAL || peek().type == Tipo_de_token::GREATER_EQUAL) {
-        Token op = advance();
-        auto right = parseAdditive();
-        left = std::make_unique<BinaryOpNode>(std::move(left), op, std::move(right));
+// Argumentos de uma chamada, apos o '('; ficam no topo de pendingExprs
+template <class Sink>
+void BasicParser<Sink>::parseArguments() {
+    if (peekType() != Tipo_de_token::CLOSE_PAREN) {
+        do {
+            Expr argumento = parseExpression();
+            pendingExprs.push_back(argumento);
+        } while (match(Tipo_de_token::COMMA));
     }
-    return left;
+    expect(Tipo_de_token::CLOSE_PAREN, "Esperado ')' apos os argumentos.");
 }
 
-inline ExprPtr Parser::parseAdditive() {
-    auto left = parseMultiplicative();
-    while (peek().type == Tipo_de_token::PLUS || peek().type == Tipo_de_token::MINUS) {
+// Laco Pratt: consome operadores binarios enquanto o nivel deles for pelo
+// menos 'minimo'. O lado direito e lido com nivel + 1, entao operadores do
+// mesmo nivel associam a esquerda.
+template <class Sink>
+auto BasicParser<Sink>::parseExpression(uint8_t minimo) -> Expr {
+    Nesting guarda(*this);
+    auto left = parsePrefix();
+    for (;;) {
+        const uint8_t nivel = precedence::of(peekType()).infixo;
+        if (nivel < minimo || nivel == 0) break;
         Token op = advance();
-        auto right = parseMultiplicative();
-        left = std::make_unique<BinaryOpNode>(std::move(left), op, std::move(right));
+        auto right = parseExpression(nivel + 1);
+        left = sink.binary(left, op, right);
     }
     return left;
 }
 
-inline ExprPtr Parser::parseMultiplicative() {
-    auto left = parsePrimary();
-    while (peek().type == Tipo_de_token::MULTIPLY || peek().type == Tipo_de_token::DIVIDE || peek().type == Tipo_de_token::DIV) {
-        Token op = advance();
-        auto right = parsePrimary();
-        left = std::make_unique<BinaryOpNode>(std::move(left), op, std::move(right));
-    }
-    return left;
+template <class Sink>
+auto BasicParser<Sink>::parsePrefix() -> Expr {
+    const uint8_t nivel = precedence::of(peekType()).prefixo;
+    if (nivel == 0) return parsePrimary();
+    Token op = advance();
+    auto operand = parseExpression(nivel);
+    return sink.unary(op, operand);
 }
 
-inline ExprPtr Parser::parsePrimary() {
-    if (peek().type == Tipo_de_token::INT_LIT || peek().type == Tipo_de_token::REAL_LIT ||
-        peek().type == Tipo_de_token::STRING_LIT || peek().type == Tipo_de_token::BOOL_LIT) {
-        return std::make_unique<LiteralNode>(advance());
+template <class Sink>
+auto BasicParser<Sink>::parsePrimary() -> Expr {
+    if (peekType() == Tipo_de_token::INT_LIT || peekType() == Tipo_de_token::REAL_LIT ||
+        peekType() == Tipo_de_token::STRING_LIT || peekType() == Tipo_de_token::BOOL_LIT) {
+        return sink.literal(advance());
     }
-    if (peek().type == Tipo_de_token::IDENTIFIER) {
-        return std::make_unique<IdentifierNode>(advance());
+    if (peekType() == Tipo_de_token::IDENTIFIER) {
+        Token id = advance();
+        if (!has() || kindAt() != Tipo_de_token::OPEN_PAREN) return sink.identifier(id);
+        skip();
+        const size_t inicio = pendingExprs.size();
+        parseArguments();
+        Expr chamada = sink.funcCall(id, pendingExprs.data() + inicio, pendingExprs.size() - inicio);
+        pendingExprs.resize(inicio);
+        return chamada;
     }
     if (match(Tipo_de_token::OPEN_PAREN)) {
         auto expr = parseExpression();
         expect(Tipo_de_token::CLOSE_PAREN, "Esperado ')' para fechar expressao.");
         return expr;
     }
-    throw std::runtime_error("Expressao primaria inesperada na linha " + std::to_string(peek().line));
+    if (peekType() == Tipo_de_token::OPEN_BRACK) {
+        return parseSet();
+    }
+    fail(DiagCode::INVALID_EXPRESSION, peek().offset);
+}
+
+template <class Sink>
+auto BasicParser<Sink>::parseSet() -> Expr {
+    Token open = expect(Tipo_de_token::OPEN_BRACK, "");
+    const size_t inicio = pendingExprs.size();
+    if (peekType() != Tipo_de_token::CLOSE_BRACK) {
+        do {
+            Expr elemento = parseExpression();
+            pendingExprs.push_back(elemento);
+        } while (match(Tipo_de_token::COMMA));
+    }
+    expect(Tipo_de_token::CLOSE_BRACK, "Esperado ']' para fechar o conjunto.");
+    Expr conjunto = sink.set(open, pendingExprs.data() + inicio, pendingExprs.size() - inicio);
+    pendingExprs.resize(inicio);
+    return conjunto;
 }
 
-inline StmtPtr Parser::parseIf() {
+// Uma cadeia 'else if' e lida por um laco: as condicoes e os ramos 'then' ficam
+// nas pilhas pendentes e os IfNode sao montados de dentro para fora no fim, sem
+// somar um nivel de aninhamento por ramo.
+template <class Sink>
+auto BasicParser<Sink>::parseIf() -> Stmt {
     expect(Tipo_de_token::IF, "");
-    auto cond = parseExpression();
-    expect(Tipo_de_token::THEN, "Esperado 'then' apos a condicao do 'if'.");
-    auto thenBr = parseStatement();
-    StmtPtr elseBr = nullptr;
-    if (match(Tipo_de_token::ELSE)) {
-        elseBr = parseStatement();
+    const size_t ramos = pendingStmts.size();
+    Stmt elseBr {};
+    for (;;) {
+        pendingExprs.push_back(sink.ifCondition(parseExpression()));
+        expect(Tipo_de_token::THEN, "Esperado 'then' apos a condicao do 'if'.");
+        pendingStmts.push_back(parseStatement());
+        if (!match(Tipo_de_token::ELSE)) break;
+        if (!match(Tipo_de_token::IF)) {
+            elseBr = parseStatement();
+            break;
+        }
     }
-    return std::make_unique<IfNode>(std::move(cond), std::move(thenBr), std::move(elseBr));
+    while (pendingStmts.size() > ramos) {
+        elseBr = sink.ifStmt(pendingExprs.back(), pendingStmts.back(), elseBr);
+        pendingExprs.pop_back();
+        pendingStmts.pop_back();
+    }
+    return elseBr;
 }
 
-inline StmtPtr Parser::parseWhile() {
+template <class Sink>
+auto BasicParser<Sink>::parseWhile() -> Stmt {
     expect(Tipo_de_token::WHILE, "");
-    auto cond = parseExpression();
+    auto cond = sink.whileCondition(parseExpression());
     expect(Tipo_de_token::DO, "Esperado 'do' no laco 'while'.");
     auto body = parseStatement();
-    return std::make_unique<WhileNode>(std::move(cond), std::move(body));
+    return sink.whileStmt(cond, body);
 }
 
-inline StmtPtr Parser::parseFor() {
+template <class Sink>
+auto BasicParser<Sink>::parseFor() -> Stmt {
     expect(Tipo_de_token::FOR, "");
     Token var = expect(Tipo_de_token::IDENTIFIER, "Esperado variavel de controle para o 'for'.");
+    sink.forControl(var);
     expect(Tipo_de_token::ASSIGN, "Esperado ':=' no laco 'for'.");
-    auto start = parseExpression();
-    bool toUp = (peek().type == Tipo_de_token::TO);
+    auto start = sink.forStart(var, parseExpression());
+    bool toUp = (peekType() == Tipo_de_token::TO);
     if (!toUp) expect(Tipo_de_token::DOWNTO, "Esperado 'to' ou 'downto'.");
     else advance();
-    auto end = parseExpression();
+    auto end = sink.forEnd(var, parseExpression());
     expect(Tipo_de_token::DO, "Esperado 'do' no laco 'for'.");
     auto body = parseStatement();
-    return std::make_unique<ForNode>(var, std::move(start), std::move(end), toUp, std::move(body));
+    return sink.forStmt(var, start, end, toUp, body);
 }
 
-inline StmtPtr Parser::parseRepeat() {
+template <class Sink>
+auto BasicParser<Sink>::parseRepeat() -> Stmt {
     expect(Tipo_de_token::REPEAT, "");
-    std::vector<StmtPtr> stmts;
+    const size_t inicio = pendingStmts.size();
     do {
-        stmts.push_back(parseStatement());
-    } while (peek().type != Tipo_de_token::UNTIL);
+        Stmt stmt = parseStatement();
+        pendingStmts.push_back(stmt);
+    } while (peekType() != Tipo_de_token::UNTIL);
     expect(Tipo_de_token::UNTIL, "");
     auto cond = parseExpression();
     expect(Tipo_de_token::SEMICOLON, "Esperado ';' apos o 'repeat...until'.");
-    return std::make_unique<RepeatNode>(std::move(stmts), std::move(cond));
+    Stmt repeticao = sink.repeatStmt(pendingStmts.data() + inicio, pendingStmts.size() - inicio, cond);
+    pendingStmts.resize(inicio);
+    return repeticao;
 }
 
+using Parser = BasicParser<AstBuilder>;
+
 #endif
\ No newline at end of file
@@ -0,0 +1,213 @@
+#include "scan_kernels.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+
+#include "char_class.hpp"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define SCAN_KERNELS_X86 1
+#endif
+
+namespace scan {
+namespace {
+
+// ---------------------------------------------------------------- escalar
+
+const char* skipWhitespaceScalar(const char* p) {
+    while (chars::isSpace(*p)) p++;
+    return p;
+}
+
+const char* skipIdentifierScalar(const char* p) {
+    while (chars::isIdentifierChar(*p)) p++;
+    return p;
+}
+
+const char* findByteScalar(const char* p, const char* end, char c) {
+    const void* r = std::memchr(p, c, static_cast<size_t>(end - p));
+    return r ? static_cast<const char*>(r) : end;
+}
+
+const char* findEitherScalar(const char* p, const char* end, char a, char b) {
+    while (p < end && *p != a && *p != b) p++;
+    return p;
+}
+
+const char* findNonAsciiScalar(const char* p, const char* end) {
+    // 8 bytes por vez enquanto nenhum tiver o bit alto ligado
+    while (end - p >= 8) {
+        uint64_t w;
+        std::memcpy(&w, p, sizeof(w));
+        if (w & 0x8080808080808080ull) break;
+        p += 8;
+    }
+    while (p < end && !(static_cast<unsigned char>(*p) & 0x80)) p++;
+    return p;
+}
+
+#ifdef SCAN_KERNELS_X86
+
+// ---------------------------------------------------------------- SSE2
+// As mascaras marcam com 1 os bytes que PERTENCEM a sequencia; o primeiro zero
+// da mascara e o fim dela. Uma carga so acontece se todos os bytes anteriores
+// pertencem a sequencia, logo comeca no maximo no sentinela e termina dentro do
+// PADDING.
+
+inline unsigned whitespaceMask16(__m128i v) {
+    // ' ' ou '\t'..'\r' (comparacao sem sinal via min)
+    __m128i sp = _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+    __m128i d = _mm_sub_epi8(v, _mm_set1_epi8('\t'));
+    __m128i ctl = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(4)), d);
+    return static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(sp, ctl)));
+}
+
+inline unsigned identifierMask16(__m128i v) {
+    __m128i lower = _mm_sub_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    __m128i alpha = _mm_cmpeq_epi8(_mm_min_epu8(lower, _mm_set1_epi8(25)), lower);
+    __m128i d = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+    __m128i digit = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d);
+    __m128i under = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+    return static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(alpha, digit), under)));
+}
+
+template <unsigned (*Mask)(__m128i)>
+const char* skipSse2(const char* p) {
+    for (;; p += 16) {
+        unsigned fora = ~Mask(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) & 0xFFFFu;
+        if (fora) return p + __builtin_ctz(fora);
+    }
+}
+
+const char* findByteSse2(const char* p, const char* end, char c) {
+    const __m128i alvo = _mm_set1_epi8(c);
+    while (end - p >= 16) {
+        unsigned m = static_cast<unsigned>(_mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), alvo)));
+        if (m) return p + __builtin_ctz(m);
+        p += 16;
+    }
+    return findByteScalar(p, end, c);
+}
+
+const char* findEitherSse2(const char* p, const char* end, char a, char b) {
+    const __m128i alvoA = _mm_set1_epi8(a);
+    const __m128i alvoB = _mm_set1_epi8(b);
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        unsigned m = static_cast<unsigned>(_mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(v, alvoA), _mm_cmpeq_epi8(v, alvoB))));
+        if (m) return p + __builtin_ctz(m);
+        p += 16;
+    }
+    return findEitherScalar(p, end, a, b);
+}
+
+const char* findNonAsciiSse2(const char* p, const char* end) {
+    while (end - p >= 16) {
+        unsigned m = static_cast<unsigned>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))));
+        if (m) return p + __builtin_ctz(m);
+        p += 16;
+    }
+    return findNonAsciiScalar(p, end);
+}
+
+// ---------------------------------------------------------------- AVX2
+
+__attribute__((target("avx2"))) inline unsigned whitespaceMask32(__m256i v) {
+    __m256i sp = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '));
+    __m256i d = _mm256_sub_epi8(v, _mm256_set1_epi8('\t'));
+    __m256i ctl = _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(4)), d);
+    return static_cast<unsigned>(_mm256_movemask_epi8(_mm256_or_si256(sp, ctl)));
+}
+
+__attribute__((target("avx2"))) inline unsigned identifierMask32(__m256i v) {
+    __m256i lower = _mm256_sub_epi8(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+    __m256i alpha = _mm256_cmpeq_epi8(_mm256_min_epu8(lower, _mm256_set1_epi8(25)), lower);
+    __m256i d = _mm256_sub_epi8(v, _mm256_set1_epi8('0'));
+    __m256i digit = _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(9)), d);
+    __m256i under = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+    return static_cast<unsigned>(_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(alpha, digit), under)));
+}
+
+__attribute__((target("avx2"))) const char* skipWhitespaceAvx2(const char* p) {
+    for (;; p += 32) {
+        unsigned fora = ~whitespaceMask32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+        if (fora) return p + __builtin_ctz(fora);
+    }
+}
+
+__attribute__((target("avx2"))) const char* skipIdentifierAvx2(const char* p) {
+    for (;; p += 32) {
+        unsigned fora = ~identifierMask32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+        if (fora) return p + __builtin_ctz(fora);
+    }
+}
+
+__attribute__((target("avx2"))) const char* findByteAvx2(const char* p, const char* end, char c) {
+    const __m256i alvo = _mm256_set1_epi8(c);
+    while (end - p >= 32) {
+        unsigned m = static_cast<unsigned>(_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), alvo)));
+        if (m) return p + __builtin_ctz(m);
+        p += 32;
+    }
+    return findByteSse2(p, end, c);
+}
+
+__attribute__((target("avx2"))) const char* findEitherAvx2(const char* p, const char* end, char a, char b) {
+    const __m256i alvoA = _mm256_set1_epi8(a);
+    const __m256i alvoB = _mm256_set1_epi8(b);
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        unsigned m = static_cast<unsigned>(_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, alvoA), _mm256_cmpeq_epi8(v, alvoB))));
+        if (m) return p + __builtin_ctz(m);
+        p += 32;
+    }
+    return findEitherSse2(p, end, a, b);
+}
+
+__attribute__((target("avx2"))) const char* findNonAsciiAvx2(const char* p, const char* end) {
+    while (end - p >= 32) {
+        unsigned m = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))));
+        if (m) return p + __builtin_ctz(m);
+        p += 32;
+    }
+    return findNonAsciiSse2(p, end);
+}
+
+#endif // SCAN_KERNELS_X86
+
+const Kernels ESCALAR {"escalar", skipWhitespaceScalar, skipIdentifierScalar, findByteScalar, findEitherScalar, findNonAsciiScalar};
+#ifdef SCAN_KERNELS_X86
+const Kernels SSE2 {"sse2", skipSse2<whitespaceMask16>, skipSse2<identifierMask16>, findByteSse2, findEitherSse2, findNonAsciiSse2};
+const Kernels AVX2 {"avx2", skipWhitespaceAvx2, skipIdentifierAvx2, findByteAvx2, findEitherAvx2, findNonAsciiAvx2};
+#endif
+
+const Kernels& select() {
+    const char* forcado = std::getenv("PASCAL_SCAN");
+    std::string_view pedido = forcado ? forcado : "";
+    if (pedido == "escalar") return ESCALAR;
+#ifdef SCAN_KERNELS_X86
+    __builtin_cpu_init();
+    bool temAvx2 = __builtin_cpu_supports("avx2");
+    if (pedido == "sse2") return SSE2;
+    if (temAvx2 && (pedido.empty() || pedido == "avx2")) return AVX2;
+    return SSE2;
+#else
+    return ESCALAR;
+#endif
+}
+
+} // namespace
+
+const Kernels& kernels() {
+    static const Kernels& escolhidos = select();
+    return escolhidos;
+}
+
+} // namespace scan
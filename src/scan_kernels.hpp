@@ -0,0 +1,40 @@
+#ifndef SCAN_KERNELS_HPP
+#define SCAN_KERNELS_HPP
+
+#include <cstddef>
+
+// Rotinas de varredura usadas no laco principal do Tokenizer.
+// Cada rotina devolve o primeiro byte a partir de 'p' que encerra a sequencia;
+// findByte, findEither e findNonAscii examinam apenas [p, end) e devolvem 'end'
+// se nao encontrarem o byte. Em x86 ha versoes SSE2 (16 bytes por vez) e AVX2 (32 bytes por vez),
+// escolhidas em tempo de execucao; nas demais arquiteturas usa-se a versao escalar.
+// A variavel de ambiente PASCAL_SCAN=escalar|sse2|avx2 forca uma implementacao.
+namespace scan {
+
+// O texto analisado deve ser seguido de PADDING bytes NUL. skipWhitespace e
+// skipIdentifier param no NUL sentinela em vez de comparar com o fim, e as
+// versoes SIMD podem carregar um vetor inteiro sem tratar a cauda a parte.
+constexpr size_t PADDING = 64;
+
+struct Kernels {
+    const char* name;
+    const char* (*skipWhitespace)(const char* p);
+    const char* (*skipIdentifier)(const char* p);
+    const char* (*findByte)(const char* p, const char* end, char c);
+    const char* (*findEither)(const char* p, const char* end, char a, char b);
+    const char* (*findNonAscii)(const char* p, const char* end);
+};
+
+const Kernels& kernels();
+
+inline const char* skipWhitespace(const char* p) { return kernels().skipWhitespace(p); }
+inline const char* skipIdentifier(const char* p) { return kernels().skipIdentifier(p); }
+inline const char* findByte(const char* p, const char* end, char c) { return kernels().findByte(p, end, c); }
+// Primeira ocorrencia de 'a' ou de 'b' (usada nos comentarios aninhados)
+inline const char* findEither(const char* p, const char* end, char a, char b) { return kernels().findEither(p, end, a, b); }
+// Primeiro byte >= 0x80 (usada na validacao de UTF-8)
+inline const char* findNonAscii(const char* p, const char* end) { return kernels().findNonAscii(p, end); }
+
+} // namespace scan
+
+#endif
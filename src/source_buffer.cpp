@@ -0,0 +1,120 @@
+#include "source_buffer.hpp"
+
+#include <utility>
+
+#include "scan_kernels.hpp"
+#include "utf8.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define SOURCE_BUFFER_POSIX 1
+#else
+#include <fstream>
+#include <sstream>
+#endif
+
+SourceBuffer::SourceBuffer(SourceBuffer&& outro) noexcept {
+    *this = std::move(outro);
+}
+
+SourceBuffer& SourceBuffer::operator=(SourceBuffer&& outro) noexcept {
+    if (this == &outro) return *this;
+    release();
+    m_mapped = std::exchange(outro.m_mapped, false);
+    m_size = std::exchange(outro.m_size, 0);
+    m_mapLength = std::exchange(outro.m_mapLength, 0);
+    m_bom = std::exchange(outro.m_bom, 0);
+    m_owned = std::move(outro.m_owned);
+    m_data = m_mapped ? std::exchange(outro.m_data, "") : m_owned.data();
+    outro.m_data = "";
+    return *this;
+}
+
+SourceBuffer::~SourceBuffer() {
+    release();
+}
+
+void SourceBuffer::release() {
+#ifdef SOURCE_BUFFER_POSIX
+    if (m_mapped) munmap(const_cast<char*>(m_data), m_mapLength);
+#endif
+    m_mapped = false;
+    m_data = "";
+    m_size = 0;
+    m_mapLength = 0;
+    m_bom = 0;
+    m_owned.clear();
+}
+
+void SourceBuffer::skipBom() {
+    if (std::string_view(m_data, m_size).substr(0, utf8::BOM.size()) == utf8::BOM) m_bom = utf8::BOM.size();
+}
+
+#ifdef SOURCE_BUFFER_POSIX
+
+std::optional<SourceBuffer> SourceBuffer::load(const std::string& caminho) {
+    int fd = ::open(caminho.c_str(), O_RDONLY);
+    if (fd < 0) return {};
+
+    SourceBuffer buffer;
+    struct stat info {};
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        // Reserva paginas anonimas (zeradas) para o arquivo mais o preenchimento e
+        // mapeia o arquivo por cima do inicio delas. O resto da ultima pagina do
+        // arquivo tambem e zerado pelo kernel, entao o sentinela vem sem copia.
+        const size_t tamanho = static_cast<size_t>(info.st_size);
+        const size_t pagina = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        const size_t reservado = (tamanho + scan::PADDING + pagina - 1) / pagina * pagina;
+        void* base = mmap(nullptr, reservado, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base != MAP_FAILED) {
+            void* p = mmap(base, tamanho, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
+            if (p != MAP_FAILED) {
+                madvise(p, tamanho, MADV_SEQUENTIAL);
+                buffer.m_data = static_cast<const char*>(p);
+                buffer.m_size = tamanho;
+                buffer.m_mapLength = reservado;
+                buffer.m_mapped = true;
+                buffer.skipBom();
+                ::close(fd);
+                return buffer;
+            }
+            munmap(base, reservado);
+        }
+    }
+
+    // Fallback para pipes, dispositivos e falhas do mmap
+    char bloco[64 * 1024];
+    for (;;) {
+        ssize_t lidos = ::read(fd, bloco, sizeof(bloco));
+        if (lidos < 0) { ::close(fd); return {}; }
+        if (lidos == 0) break;
+        buffer.m_owned.append(bloco, static_cast<size_t>(lidos));
+    }
+    ::close(fd);
+    buffer.m_size = buffer.m_owned.size();
+    buffer.m_owned.append(scan::PADDING, '\0');
+    buffer.m_data = buffer.m_owned.data();
+    buffer.skipBom();
+    return buffer;
+}
+
+#else
+
+std::optional<SourceBuffer> SourceBuffer::load(const std::string& caminho) {
+    std::ifstream arquivo(caminho, std::ios::binary);
+    if (!arquivo.is_open()) return {};
+    SourceBuffer buffer;
+    std::stringstream conteudoStream;
+    conteudoStream << arquivo.rdbuf();
+    buffer.m_owned = conteudoStream.str();
+    buffer.m_size = buffer.m_owned.size();
+    buffer.m_owned.append(scan::PADDING, '\0');
+    buffer.m_data = buffer.m_owned.data();
+    buffer.skipBom();
+    return buffer;
+}
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef SOURCE_BUFFER_HPP
+#define SOURCE_BUFFER_HPP
+
+#include <string>
+#include <string_view>
+#include <optional>
+#include <cstddef>
+
+// Buffer somente-leitura com o conteudo de um arquivo fonte.
+// Arquivos regulares sao mapeados em memoria (mmap), entao a analise lexica
+// comeca sem copiar o arquivo e as paginas podem ser compartilhadas entre threads.
+// Pipes e dispositivos, que nao podem ser mapeados, sao lidos com read().
+// Em ambos os casos o conteudo e seguido de scan::PADDING bytes NUL, que o
+// Tokenizer usa como sentinela (ver scan_kernels.hpp). Um BOM UTF-8 no inicio
+// do arquivo nao faz parte de view(): os offsets comecam depois dele.
+class SourceBuffer {
+public:
+    static std::optional<SourceBuffer> load(const std::string& caminho);
+
+    SourceBuffer(const SourceBuffer&) = delete;
+    SourceBuffer& operator=(const SourceBuffer&) = delete;
+    SourceBuffer(SourceBuffer&& outro) noexcept;
+    SourceBuffer& operator=(SourceBuffer&& outro) noexcept;
+    ~SourceBuffer();
+
+    [[nodiscard]] const char* data() const { return m_data + m_bom; }
+    [[nodiscard]] size_t size() const { return m_size - m_bom; }
+    [[nodiscard]] std::string_view view() const { return {data(), size()}; }
+    [[nodiscard]] bool mapped() const { return m_mapped; }
+    [[nodiscard]] bool hadBom() const { return m_bom != 0; }
+
+private:
+    SourceBuffer() = default;
+    void release();
+    void skipBom();
+
+    const char* m_data = "";
+    size_t m_size = 0;
+    size_t m_bom = 0;       // bytes do BOM omitidos no inicio
+    bool m_mapped = false;
+    size_t m_mapLength = 0; // regiao reservada: arquivo + preenchimento, em paginas inteiras
+    std::string m_owned; // usado apenas quando o arquivo nao pode ser mapeado
+};
+
+#endif
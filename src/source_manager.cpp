@@ -0,0 +1,43 @@
+#include "source_manager.hpp"
+
+#include <algorithm>
+
+#include "diagnostics.hpp"
+
+std::optional<SourceManager::FileId> SourceManager::load(const std::string& caminho) {
+    std::optional<SourceBuffer> buffer = SourceBuffer::load(caminho);
+    if (!buffer) return {};
+    return add(caminho, std::move(buffer), {});
+}
+
+std::optional<SourceManager::FileId> SourceManager::addBuffer(std::string nome, std::string_view texto) {
+    return add(std::move(nome), std::nullopt, texto);
+}
+
+std::optional<SourceManager::FileId> SourceManager::add(std::string nome, std::optional<SourceBuffer> buffer, std::string_view texto) {
+    const uint64_t tamanho = buffer ? buffer->size() : texto.size();
+    // A ultima faixa nao pode alcancar DiagnosticEngine::NO_OFFSET
+    if (m_next + tamanho + 1 > DiagnosticEngine::NO_OFFSET) return {};
+
+    const uint32_t base = static_cast<uint32_t>(m_next);
+    m_files.emplace_back(std::move(nome), std::move(buffer), texto, base);
+    m_bases.push_back(base);
+    m_next += tamanho + 1;
+    return static_cast<FileId>(m_files.size() - 1);
+}
+
+SourceManager::FileId SourceManager::fileOf(uint32_t pos) const {
+    auto it = std::upper_bound(m_bases.begin(), m_bases.end(), pos);
+    return static_cast<FileId>(it - m_bases.begin()) - 1;
+}
+
+SourceManager::Location SourceManager::decode(uint32_t pos) const {
+    const FileId id = fileOf(pos);
+    LineIndex::Position p = m_files[id].lines.position(pos - m_files[id].base);
+    return {id, p.line, p.col};
+}
+
+std::string_view SourceManager::spelling(uint32_t pos, uint32_t tamanho) const {
+    const File& f = m_files[fileOf(pos)];
+    return f.text.substr(pos - f.base, tamanho);
+}
@@ -0,0 +1,72 @@
+#ifndef SOURCE_MANAGER_HPP
+#define SOURCE_MANAGER_HPP
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "line_index.hpp"
+#include "source_buffer.hpp"
+
+// Arquivos fonte de uma compilacao num unico espaco de posicoes de 32 bits.
+// Cada arquivo carregado recebe a faixa [base, base + tamanho] (a posicao extra
+// e o fim do arquivo), logo depois da faixa do arquivo anterior. Uma posicao e
+// entao um unico uint32_t que identifica arquivo e byte ao mesmo tempo: tokens
+// e nos da AST nao precisam guardar o arquivo, posicoes de arquivos diferentes
+// se comparam diretamente e arquivo/linha/coluna so sao calculados em decode().
+class SourceManager {
+public:
+    using FileId = uint32_t;
+
+    struct Location {
+        FileId file;
+        int line;
+        int col;
+    };
+
+    SourceManager() = default;
+    SourceManager(const SourceManager&) = delete;
+    SourceManager& operator=(const SourceManager&) = delete;
+
+    // nullopt se o arquivo nao pode ser aberto ou nao cabe no espaco de posicoes
+    std::optional<FileId> load(const std::string& caminho);
+    // Registra um texto que ja esta em memoria. Como em SourceBuffer, 'texto' deve
+    // ser seguido de scan::PADDING bytes NUL e viver tanto quanto o SourceManager.
+    std::optional<FileId> addBuffer(std::string nome, std::string_view texto);
+
+    [[nodiscard]] size_t files() const { return m_files.size(); }
+    [[nodiscard]] const std::string& name(FileId id) const { return m_files[id].name; }
+    [[nodiscard]] std::string_view text(FileId id) const { return m_files[id].text; }
+    [[nodiscard]] uint32_t base(FileId id) const { return m_files[id].base; }
+    [[nodiscard]] bool hadBom(FileId id) const { return m_files[id].buffer && m_files[id].buffer->hadBom(); }
+    [[nodiscard]] const LineIndex& lines(FileId id) const { return m_files[id].lines; }
+
+    // Arquivo que contem a posicao global 'pos'
+    [[nodiscard]] FileId fileOf(uint32_t pos) const;
+    [[nodiscard]] Location decode(uint32_t pos) const;
+    // Texto de [pos, pos + tamanho), que nao pode atravessar arquivos
+    [[nodiscard]] std::string_view spelling(uint32_t pos, uint32_t tamanho) const;
+
+private:
+    struct File {
+        File(std::string nome, std::optional<SourceBuffer> buf, std::string_view texto, uint32_t inicio)
+            : name(std::move(nome)), buffer(std::move(buf)), text(buffer ? buffer->view() : texto), base(inicio), lines(text) {}
+
+        std::string name;
+        std::optional<SourceBuffer> buffer; // vazio para textos registrados por addBuffer
+        std::string_view text;
+        uint32_t base;
+        LineIndex lines;
+    };
+
+    std::optional<FileId> add(std::string nome, std::optional<SourceBuffer> buffer, std::string_view texto);
+
+    std::deque<File> m_files; // deque: LineIndex nao e movivel e as referencias continuam validas
+    std::vector<uint32_t> m_bases;
+    uint64_t m_next = 0;
+};
+
+#endif
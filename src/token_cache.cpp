@@ -0,0 +1,244 @@
+#include "token_cache.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+
+#include "source_buffer.hpp"
+
+namespace {
+
+constexpr char MAGIC[4] = {'T', 'O', 'K', 'C'};
+
+// Cabecalho do arquivo .tokc, seguido pelos vetores na ordem:
+// payloads (u64), offsets (u32), lengths (u32), tamanhos dos nomes (u32),
+// tipos (u8) e bytes dos nomes. Os u64 vem primeiro para ficarem alinhados.
+struct Header {
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceHash;
+    uint64_t sourceSize;
+    uint32_t base;
+    uint32_t flags;
+    uint32_t symbolCount;
+    uint32_t reserved;
+    uint64_t tokenCount;
+    uint64_t namesBytes;
+};
+static_assert(sizeof(Header) % alignof(uint64_t) == 0, "os payloads devem comecar alinhados");
+
+constexpr size_t BYTES_POR_TOKEN = sizeof(uint64_t) + 2 * sizeof(uint32_t) + sizeof(uint8_t);
+constexpr size_t TIPOS = static_cast<size_t>(Tipo_de_token::COLON) + 1;
+
+// XXH64
+constexpr uint64_t P1 = 11400714785074694791ULL;
+constexpr uint64_t P2 = 14029467366897019727ULL;
+constexpr uint64_t P3 = 1609587929392839161ULL;
+constexpr uint64_t P4 = 9650029242287828579ULL;
+constexpr uint64_t P5 = 2870177450012600261ULL;
+
+inline uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline uint64_t read64(const char* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof v);
+    return v;
+}
+
+inline uint32_t read32(const char* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof v);
+    return v;
+}
+
+inline uint64_t mix(uint64_t acc, uint64_t entrada) {
+    acc += entrada * P2;
+    return rotl(acc, 31) * P1;
+}
+
+inline uint64_t mergeRound(uint64_t acc, uint64_t v) {
+    acc ^= mix(0, v);
+    return acc * P1 + P4;
+}
+
+} // namespace
+
+uint64_t TokenCache::hash(std::string_view dados, uint64_t semente) {
+    const char* p = dados.data();
+    const char* fim = p + dados.size();
+    uint64_t h;
+
+    // Quatro acumuladores independentes por bloco de 32 bytes
+    if (dados.size() >= 32) {
+        uint64_t v1 = semente + P1 + P2, v2 = semente + P2, v3 = semente, v4 = semente - P1;
+        for (; fim - p >= 32; p += 32) {
+            v1 = mix(v1, read64(p));
+            v2 = mix(v2, read64(p + 8));
+            v3 = mix(v3, read64(p + 16));
+            v4 = mix(v4, read64(p + 24));
+        }
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = mergeRound(h, v1);
+        h = mergeRound(h, v2);
+        h = mergeRound(h, v3);
+        h = mergeRound(h, v4);
+    } else {
+        h = semente + P5;
+    }
+    h += dados.size();
+
+    for (; fim - p >= 8; p += 8) h = rotl(h ^ mix(0, read64(p)), 27) * P1 + P4;
+    if (fim - p >= 4) {
+        h = rotl(h ^ (read32(p) * P1), 23) * P2 + P3;
+        p += 4;
+    }
+    for (; p < fim; p++) h = rotl(h ^ (static_cast<unsigned char>(*p) * P5), 11) * P1;
+
+    h ^= h >> 33;
+    h *= P2;
+    h ^= h >> 29;
+    h *= P3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint32_t TokenCache::version() {
+    static const uint32_t versao = [] {
+        // Impressao digital das tabelas que decidem os tokens
+        std::string tabelas;
+        for (const keywords::Entry& e : keywords::LIST) {
+            tabelas += e.word;
+            tabelas += static_cast<char>(e.type);
+        }
+        for (const operators::Entry& e : operators::TABLE) {
+            tabelas += static_cast<char>(e.simples);
+            tabelas += static_cast<char>(e.continuacoes);
+            tabelas.append(e.segundo, 2);
+            tabelas += static_cast<char>(e.composto[0]);
+            tabelas += static_cast<char>(e.composto[1]);
+        }
+        for (uint8_t f : chars::FLAGS) tabelas += static_cast<char>(f);
+        for (chars::Acao a : chars::ACOES) tabelas += static_cast<char>(a);
+        tabelas += static_cast<char>(TIPOS);
+        tabelas += static_cast<char>(sizeof(Token));
+        return (LEXER_VERSION << 24) ^ static_cast<uint32_t>(hash(tabelas) & 0xFFFFFF);
+    }();
+    return versao;
+}
+
+TokenCache::Key TokenCache::keyFor(std::string_view fonte, uint32_t base, bool aninhados) {
+    return {hash(fonte), fonte.size(), base, aninhados ? NESTED_COMMENTS : 0u};
+}
+
+std::string TokenCache::path(const Key& chave) const {
+    char nome[32];
+    std::snprintf(nome, sizeof(nome), "%016llx.tokc", static_cast<unsigned long long>(chave.hash));
+    return (std::filesystem::path(m_dir) / nome).string();
+}
+
+std::optional<TokenStream> TokenCache::load(const Key& chave, Interner& simbolos) {
+    std::optional<SourceBuffer> arquivo = SourceBuffer::load(path(chave));
+    auto falha = [this]() -> std::optional<TokenStream> { m_misses++; return {}; };
+    if (!arquivo || arquivo->size() < sizeof(Header)) return falha();
+
+    const char* base = arquivo->data();
+    Header h;
+    std::memcpy(&h, base, sizeof h);
+    if (std::memcmp(h.magic, MAGIC, sizeof MAGIC) != 0 || h.version != version() ||
+        h.sourceHash != chave.hash || h.sourceSize != chave.size || h.base != chave.base || h.flags != chave.flags) {
+        return falha();
+    }
+
+    // Confere o tamanho antes de confiar nos contadores do cabecalho
+    const size_t resto = arquivo->size() - sizeof(Header);
+    if (h.tokenCount > resto / BYTES_POR_TOKEN) return falha();
+    const size_t bytesTokens = h.tokenCount * BYTES_POR_TOKEN;
+    if (h.symbolCount > (resto - bytesTokens) / sizeof(uint32_t)) return falha();
+    const size_t bytesTamanhos = h.symbolCount * sizeof(uint32_t);
+    if (h.namesBytes != resto - bytesTokens - bytesTamanhos) return falha();
+
+    const size_t n = h.tokenCount;
+    const char* p = base + sizeof(Header);
+    auto payloads = reinterpret_cast<const uint64_t*>(p);
+    auto offsets = reinterpret_cast<const uint32_t*>(p + n * sizeof(uint64_t));
+    auto lengths = offsets + n;
+    auto tamanhos = lengths + n;
+    auto kinds = reinterpret_cast<const uint8_t*>(tamanhos + h.symbolCount);
+    const char* nomes = reinterpret_cast<const char*>(kinds + n);
+
+    // Reconstroi a tabela de simbolos; nomes repetidos indicariam um arquivo corrompido
+    Interner tabela;
+    size_t pos = 0;
+    for (uint32_t id = 0; id < h.symbolCount; id++) {
+        if (tamanhos[id] > h.namesBytes - pos) return falha();
+        if (tabela.intern({nomes + pos, tamanhos[id]}) != id) return falha();
+        pos += tamanhos[id];
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        const uint64_t local = static_cast<uint64_t>(offsets[i]) - h.base;
+        if (kinds[i] >= TIPOS || offsets[i] < h.base || local > h.sourceSize || lengths[i] > h.sourceSize - local) return falha();
+        if (kinds[i] == static_cast<uint8_t>(Tipo_de_token::IDENTIFIER) && payloads[i] >= h.symbolCount) return falha();
+    }
+
+    simbolos = std::move(tabela);
+    m_hits++;
+    auto dono = std::make_shared<SourceBuffer>(std::move(*arquivo));
+    return TokenStream::view(std::move(dono), n, kinds, offsets, lengths, payloads);
+}
+
+bool TokenCache::store(const Key& chave, const TokenStream& tokens, const Interner& simbolos) {
+    std::error_code erro;
+    std::filesystem::create_directories(m_dir, erro);
+    if (erro) return false;
+
+    const size_t n = tokens.size();
+    Header h {};
+    std::memcpy(h.magic, MAGIC, sizeof MAGIC);
+    h.version = version();
+    h.sourceHash = chave.hash;
+    h.sourceSize = chave.size;
+    h.base = chave.base;
+    h.flags = chave.flags;
+    h.symbolCount = static_cast<uint32_t>(simbolos.size());
+    h.tokenCount = n;
+    std::vector<uint32_t> tamanhos(simbolos.size());
+    for (uint32_t id = 0; id < tamanhos.size(); id++) {
+        tamanhos[id] = static_cast<uint32_t>(simbolos.name(id).size());
+        h.namesBytes += tamanhos[id];
+    }
+
+    // Nome temporario unico: escritores concorrentes nao se atrapalham e o rename
+    // publica a entrada de uma vez
+    const std::string destino = path(chave);
+    const std::string temporario = destino + ".tmp" +
+        std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    {
+        std::ofstream out(temporario, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+        auto escreve = [&out](const void* dados, size_t bytes) {
+            out.write(static_cast<const char*>(dados), static_cast<std::streamsize>(bytes));
+        };
+        escreve(&h, sizeof h);
+        escreve(tokens.payloads(), n * sizeof(uint64_t));
+        escreve(tokens.offsets(), n * sizeof(uint32_t));
+        escreve(tokens.lengths(), n * sizeof(uint32_t));
+        escreve(tamanhos.data(), tamanhos.size() * sizeof(uint32_t));
+        escreve(tokens.kinds(), n);
+        for (uint32_t id = 0; id < tamanhos.size(); id++) escreve(simbolos.name(id).data(), tamanhos[id]);
+        if (!out.flush()) {
+            out.close();
+            std::remove(temporario.c_str());
+            return false;
+        }
+    }
+    std::filesystem::rename(temporario, destino, erro);
+    if (erro) {
+        std::remove(temporario.c_str());
+        return false;
+    }
+    m_writes++;
+    return true;
+}
@@ -0,0 +1,63 @@
+#ifndef TOKEN_CACHE_HPP
+#define TOKEN_CACHE_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "tokenization.hpp"
+
+// Cache persistente da analise lexica. O arquivo <diretorio>/<hash>.tokc guarda
+// a sequencia de tokens em estrutura-de-vetores, exatamente como o TokenStream
+// a le, e a tabela de simbolos na ordem dos IDs. Num acerto o arquivo e mapeado
+// em memoria e o TokenStream aponta direto para ele: nenhum byte do fonte e
+// varrido de novo.
+//
+// A entrada so e aceita se o hash (XXH64) e o tamanho do fonte, a base do
+// arquivo no SourceManager (os offsets gravados sao globais), as opcoes do
+// lexico e a versao coincidem. A versao junta TokenCache::LEXER_VERSION, que deve
+// ser incrementada a cada mudanca de comportamento do lexico ou do formato do
+// arquivo, com uma impressao digital das tabelas de palavras reservadas,
+// operadores e classes de caracteres, entao mudancas nessas tabelas invalidam o
+// cache sem intervencao manual.
+class TokenCache {
+public:
+    static constexpr uint32_t LEXER_VERSION = 2;
+
+    // Identifica o fonte e as opcoes do lexico que afetam os tokens
+    struct Key {
+        uint64_t hash = 0;
+        uint64_t size = 0;
+        uint32_t base = 0;
+        uint32_t flags = 0;
+    };
+
+    enum Flag : uint32_t { NESTED_COMMENTS = 1u << 0 };
+
+    explicit TokenCache(std::string diretorio) : m_dir(std::move(diretorio)) {}
+
+    static uint64_t hash(std::string_view dados, uint64_t semente = 0);
+    static uint32_t version();
+    static Key keyFor(std::string_view fonte, uint32_t base, bool aninhados);
+
+    [[nodiscard]] std::string path(const Key& chave) const;
+
+    // Num acerto devolve os tokens e substitui 'simbolos' pela tabela gravada,
+    // com os mesmos IDs que a analise lexica teria atribuido.
+    std::optional<TokenStream> load(const Key& chave, Interner& simbolos);
+    // Grava a entrada (arquivo temporario + rename); devolve false se nao foi possivel.
+    bool store(const Key& chave, const TokenStream& tokens, const Interner& simbolos);
+
+    [[nodiscard]] size_t hits() const { return m_hits; }
+    [[nodiscard]] size_t misses() const { return m_misses; }
+    [[nodiscard]] size_t writes() const { return m_writes; }
+
+private:
+    std::string m_dir;
+    size_t m_hits = 0;
+    size_t m_misses = 0;
+    size_t m_writes = 0;
+};
+
+#endif
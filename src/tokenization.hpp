@@ -1,17 +1,29 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
+#include <memory>
 #include <optional>
+#include <array>
+#include <stdexcept>
+#include <charconv>
+#include <cstring>
+#include <cstdint>
 #include <iostream>
-#include <unordered_map>
-#include <cctype>
 
-enum class Tipo_de_token {
+#include "scan_kernels.hpp"
+#include "diagnostics.hpp"
+#include "interner.hpp"
+#include "ascii_fold.hpp"
+#include "char_class.hpp"
+#include "utf8.hpp"
+
+enum class Tipo_de_token : uint8_t {
     // Palavras reservadas
     PROGRAM, VAR, CONST, PROCEDURE, FUNCTION, LABEL, BEGIN, END,
     DOWNTO, TO, IF, THEN, ELSE, CASE, OF, EXCEPT, RAISE, CATCH,
     TRY, FINALLY, RECORD, REPEAT, TYPE, UNTIL, USES, WHILE, FOR, DO,
-    OR, IN, AND, NOT, DIV,
+    OR, IN, AND, NOT, DIV, MOD,
 
     // Identificador e tipos
     IDENTIFIER, INTEGER, REAL, BOOLEAN, STRING,
@@ -25,123 +37,556 @@ enum class Tipo_de_token {
     CLOSE_BRACK, DOT, COMMA, SEMICOLON, COLON
 };
 
+// O token nao copia o lexema: guarda apenas o trecho [offset, offset + length)
+// do buffer fonte, que deve permanecer vivo durante toda a compilacao.
+// Para STRING_LIT o trecho inclui as aspas. O offset e a posicao global do
+// token no SourceManager (base do arquivo + posicao no buffer); arquivo, linha
+// e coluna sao obtidos apenas quando necessario.
+// 'payload' depende do tipo: ID no Interner (IDENTIFIER), valor de INT_LIT ou
+// bits do double de REAL_LIT, convertidos uma unica vez pelo lexico.
 struct Token {
     Tipo_de_token type;
-    std::optional<std::string> value {};
-    int line = 0;
-    int col = 0;
+    uint32_t offset = 0;
+    uint32_t length = 0;
+    uint64_t payload = 0;
+
+    [[nodiscard]] uint32_t symbol() const { return static_cast<uint32_t>(payload); }
+    [[nodiscard]] int64_t intValue() const { return static_cast<int64_t>(payload); }
+    [[nodiscard]] double realValue() const {
+        double valor;
+        std::memcpy(&valor, &payload, sizeof valor);
+        return valor;
+    }
+    void setRealValue(double valor) { std::memcpy(&payload, &valor, sizeof valor); }
+
+    // 'fonte' e o buffer do arquivo do token, com offsets a partir de 'base'
+    [[nodiscard]] std::string_view text(std::string_view fonte, uint32_t base = 0) const {
+        return fonte.substr(offset - base, length);
+    }
+};
+
+// Tabela de palavras reservadas com hash perfeito gerado em tempo de compilacao.
+// O hash usa o primeiro, o segundo e o ultimo caractere e o tamanho da palavra;
+// cada identificador e verificado com uma unica sondagem e sem alocacao.
+// Pascal nao diferencia maiusculas: o hash liga o bit 0x20 dos caracteres e a
+// comparacao final e feita por fold::equals, entao BEGIN, Begin e begin coincidem.
+namespace keywords {
+
+struct Entry {
+    std::string_view word;
+    Tipo_de_token type = Tipo_de_token::IDENTIFIER;
+};
+
+constexpr Entry LIST[] = {
+    {"program", Tipo_de_token::PROGRAM}, {"var", Tipo_de_token::VAR}, {"const", Tipo_de_token::CONST},
+    {"procedure", Tipo_de_token::PROCEDURE}, {"function", Tipo_de_token::FUNCTION}, {"label", Tipo_de_token::LABEL},
+    {"begin", Tipo_de_token::BEGIN}, {"end", Tipo_de_token::END}, {"downto", Tipo_de_token::DOWNTO}, {"to", Tipo_de_token::TO},
+    {"if", Tipo_de_token::IF}, {"then", Tipo_de_token::THEN}, {"else", Tipo_de_token::ELSE}, {"case", Tipo_de_token::CASE},
+    {"of", Tipo_de_token::OF}, {"except", Tipo_de_token::EXCEPT}, {"raise", Tipo_de_token::RAISE}, {"catch", Tipo_de_token::CATCH},
+    {"try", Tipo_de_token::TRY}, {"finally", Tipo_de_token::FINALLY}, {"record", Tipo_de_token::RECORD}, {"repeat", Tipo_de_token::REPEAT},
+    {"type", Tipo_de_token::TYPE}, {"until", Tipo_de_token::UNTIL}, {"uses", Tipo_de_token::USES}, {"while", Tipo_de_token::WHILE},
+    {"for", Tipo_de_token::FOR}, {"do", Tipo_de_token::DO}, {"or", Tipo_de_token::OR}, {"in", Tipo_de_token::IN},
+    {"and", Tipo_de_token::AND}, {"not", Tipo_de_token::NOT}, {"div", Tipo_de_token::DIV}, {"mod", Tipo_de_token::MOD},
+    {"integer", Tipo_de_token::INTEGER}, {"real", Tipo_de_token::REAL}, {"boolean", Tipo_de_token::BOOLEAN},
+    {"string", Tipo_de_token::STRING}, {"true", Tipo_de_token::BOOL_LIT}, {"false", Tipo_de_token::BOOL_LIT}
+};
+
+constexpr size_t MIN_LEN = 2;
+constexpr size_t MAX_LEN = 9;
+constexpr size_t TABLE_SIZE = 128;
+
+// So e chamado com MIN_LEN <= s.size() <= MAX_LEN.
+constexpr size_t hash(std::string_view s) {
+    auto c = [](char ch) { return static_cast<unsigned char>(ch) | 0x20u; };
+    return (c(s[0]) + c(s[1]) * 4u + c(s[s.size() - 1]) * 18u + s.size() * 5u) & (TABLE_SIZE - 1);
+}
+
+struct Table { Entry slots[TABLE_SIZE] {}; };
+
+constexpr Table build() {
+    Table t {};
+    for (const Entry& e : LIST) t.slots[hash(e.word)] = e;
+    return t;
+}
+
+constexpr Table TABLE = build();
+
+constexpr bool perfect() {
+    for (const Entry& e : LIST) {
+        if (e.word.size() < MIN_LEN || e.word.size() > MAX_LEN) return false;
+        if (TABLE.slots[hash(e.word)].word != e.word) return false;
+    }
+    return true;
+}
+static_assert(perfect(), "colisao na tabela de palavras reservadas: ajuste a funcao hash");
+
+} // namespace keywords
+
+// Devolve o tipo da palavra reservada ou IDENTIFIER.
+inline Tipo_de_token lookupKeyword(std::string_view s) {
+    if (s.size() < keywords::MIN_LEN || s.size() > keywords::MAX_LEN) return Tipo_de_token::IDENTIFIER;
+    const keywords::Entry& e = keywords::TABLE.slots[keywords::hash(s)];
+    return fold::equals(e.word, s) ? e.type : Tipo_de_token::IDENTIFIER;
+}
+
+// Operadores indexados pelo primeiro caractere. Cada entrada da o token de um
+// caractere e ate duas continuacoes de dois caracteres (':=', '<>', '<=', '>='),
+// entao o lexico resolve o operador com uma leitura da tabela e no maximo duas
+// comparacoes do byte seguinte.
+namespace operators {
+
+struct Entry {
+    Tipo_de_token simples {};
+    uint8_t continuacoes = 0;
+    char segundo[2] {};
+    Tipo_de_token composto[2] {};
+};
+
+constexpr std::array<Entry, 256> build() {
+    std::array<Entry, 256> t {};
+    auto um = [&t](char c, Tipo_de_token tipo) { t[static_cast<unsigned char>(c)].simples = tipo; };
+    auto dois = [&t](char c, char segundo, Tipo_de_token tipo) {
+        Entry& e = t[static_cast<unsigned char>(c)];
+        e.segundo[e.continuacoes] = segundo;
+        e.composto[e.continuacoes++] = tipo;
+    };
+    um('+', Tipo_de_token::PLUS);
+    um('-', Tipo_de_token::MINUS);
+    um('*', Tipo_de_token::MULTIPLY);
+    um('/', Tipo_de_token::DIVIDE);
+    um('=', Tipo_de_token::EQUAL);
+    um('<', Tipo_de_token::LESS);
+    um('>', Tipo_de_token::GREATER);
+    um('(', Tipo_de_token::OPEN_PAREN);
+    um(')', Tipo_de_token::CLOSE_PAREN);
+    um(';', Tipo_de_token::SEMICOLON);
+    um(':', Tipo_de_token::COLON);
+    um('.', Tipo_de_token::DOT);
+    um(',', Tipo_de_token::COMMA);
+    um('[', Tipo_de_token::OPEN_BRACK);
+    um(']', Tipo_de_token::CLOSE_BRACK);
+    dois(':', '=', Tipo_de_token::ASSIGN);
+    dois('<', '>', Tipo_de_token::NOT_EQUAL);
+    dois('<', '=', Tipo_de_token::LESS_EQUAL);
+    dois('>', '=', Tipo_de_token::GREATER_EQUAL);
+    return t;
+}
+
+constexpr std::array<Entry, 256> TABLE = build();
+
+} // namespace operators
+
+// Sequencia de tokens em layout de estrutura-de-vetores: tipos, offsets e
+// tamanhos ficam em vetores separados e compactos, entao as verificacoes de
+// tipo do Parser percorrem apenas o vetor de tipos (1 byte por token).
+// Os vetores podem ser proprios (preenchidos por push) ou apontar para uma
+// memoria externa, como o arquivo mapeado do cache de tokens (ver view()).
+class TokenStream {
+public:
+    TokenStream() = default;
+    explicit TokenStream(const std::vector<Token>& toks) {
+        reserve(toks.size());
+        for (const Token& t : toks) push(t);
+    }
+
+    TokenStream(const TokenStream&) = delete;
+    TokenStream& operator=(const TokenStream&) = delete;
+    TokenStream(TokenStream&&) = default;
+    TokenStream& operator=(TokenStream&&) = default;
+
+    // Sequencia somente-leitura sobre vetores externos; 'dono' mantem a memoria viva.
+    static TokenStream view(std::shared_ptr<const void> dono, size_t n, const uint8_t* kinds,
+                            const uint32_t* offsets, const uint32_t* lengths, const uint64_t* payloads) {
+        TokenStream s;
+        s.m_storage = std::move(dono);
+        s.m_size = n;
+        s.m_k = kinds;
+        s.m_o = offsets;
+        s.m_l = lengths;
+        s.m_p = payloads;
+        return s;
+    }
+
+    void reserve(size_t n) {
+        m_kinds.reserve(n);
+        m_offsets.reserve(n);
+        m_lengths.reserve(n);
+        m_payloads.reserve(n);
+    }
+
+    void push(const Token& t) {
+        m_kinds.push_back(static_cast<uint8_t>(t.type));
+        m_offsets.push_back(t.offset);
+        m_lengths.push_back(t.length);
+        m_payloads.push_back(t.payload);
+        m_k = m_kinds.data();
+        m_o = m_offsets.data();
+        m_l = m_lengths.data();
+        m_p = m_payloads.data();
+        m_size++;
+    }
+
+    [[nodiscard]] size_t size() const { return m_size; }
+    [[nodiscard]] Tipo_de_token kind(size_t i) const { return static_cast<Tipo_de_token>(m_k[i]); }
+
+    // Reconstroi o token completo; usado quando o Parser precisa guarda-lo na AST.
+    [[nodiscard]] Token at(size_t i) const {
+        return {kind(i), m_o[i], m_l[i], m_p[i]};
+    }
+
+    // Vetores crus, na ordem em que o cache de tokens os grava
+    [[nodiscard]] const uint8_t* kinds() const { return m_k; }
+    [[nodiscard]] const uint32_t* offsets() const { return m_o; }
+    [[nodiscard]] const uint32_t* lengths() const { return m_l; }
+    [[nodiscard]] const uint64_t* payloads() const { return m_p; }
+
+    // Bytes lidos pelas verificacoes de tipo e bytes totais ocupados
+    [[nodiscard]] size_t hotBytes() const { return m_storage ? m_size : m_kinds.capacity(); }
+    [[nodiscard]] size_t totalBytes() const {
+        if (m_storage) return m_size * (sizeof(uint8_t) + 2 * sizeof(uint32_t) + sizeof(uint64_t));
+        return m_kinds.capacity() + (m_offsets.capacity() + m_lengths.capacity()) * sizeof(uint32_t) +
+               m_payloads.capacity() * sizeof(uint64_t);
+    }
+
+private:
+    std::vector<uint8_t> m_kinds;
+    std::vector<uint32_t> m_offsets;
+    std::vector<uint32_t> m_lengths;
+    std::vector<uint64_t> m_payloads;
+    std::shared_ptr<const void> m_storage;
+
+    // Apontam para os vetores acima ou para a memoria de m_storage
+    size_t m_size = 0;
+    const uint8_t* m_k = nullptr;
+    const uint32_t* m_o = nullptr;
+    const uint32_t* m_l = nullptr;
+    const uint64_t* m_p = nullptr;
 };
 
 class Tokenizer {
 public:
-    inline explicit Tokenizer(std::string input) : m_input(std::move(input)), m_index(0), m_line(1), m_col(1) {}
+    // Os identificadores encontrados sao registrados em 'simbolos' e os erros
+    // lexicos em 'diagnosticos'.
+    // 'input' deve ser seguido de scan::PADDING bytes NUL (SourceBuffer garante isso):
+    // os lacos internos leem adiante sem verificar limites e param no sentinela.
+    inline Tokenizer(std::string_view input, Interner& simbolos, DiagnosticEngine& diagnosticos)
+        : m_input(input), m_symbols(simbolos), m_diagnostics(&diagnosticos), m_index(0), m_end(input.size()) {}
+
+    // Analisa apenas o trecho [inicio, fim) de 'input'; os offsets continuam relativos ao buffer todo.
+    // Um comentario ou string que ultrapasse 'fim' nao e tratado como erro: a analise para
+    // e pendingFrom() informa onde a construcao comecou (usado pelo lexico paralelo).
+    inline Tokenizer(std::string_view input, Interner& simbolos, DiagnosticEngine& diagnosticos, size_t inicio, size_t fim)
+        : m_input(input), m_symbols(simbolos), m_diagnostics(&diagnosticos), m_index(inicio), m_end(fim) {}
 
+    [[nodiscard]] DiagnosticEngine& diagnostics() const { return *m_diagnostics; }
+
+    // Comentarios aninhados: "{ a { b } c }" e "(* a (* b *) c *)" sao um unico
+    // comentario. Desligado por padrao, como no Pascal padrao (o primeiro
+    // terminador fecha o comentario).
+    void setNestedComments(bool ativo) { m_nested = ativo; }
+    // Posicao global do inicio de 'input' (SourceManager::base); somada aos
+    // offsets dos tokens e diagnosticos. Nao afeta pendingFrom(), que e local.
+    void setLocationBase(uint32_t base) { m_base = base; }
+    [[nodiscard]] const Interner& symbols() const { return m_symbols; }
+    [[nodiscard]] std::optional<size_t> pendingFrom() const { return m_pending; }
+    // Fim (byte seguinte ao terminador) do comentario ou string que comeca em
+    // 'inicio', procurado ate o fim de 'input' e nao so do trecho; vazio se a
+    // construcao nao fecha. Usado na costura do lexico paralelo.
+    [[nodiscard]] inline std::optional<size_t> constructEnd(size_t inicio) const;
+
+    // Modo em lote: produz todos os tokens do arquivo de uma vez.
     inline std::vector<Token> tokenize();
+    inline TokenStream tokenizeStream();
+
+    // Modo em fluxo: os tokens sao produzidos sob demanda numa janela circular
+    // de LOOKAHEAD posicoes, entao a memoria nao depende do tamanho do arquivo.
+    static constexpr size_t LOOKAHEAD = 4;
+
+    // Token k posicoes a frente (k < LOOKAHEAD), ou nullptr no fim do arquivo.
+    inline const Token* peek(size_t k = 0);
+    inline std::optional<Token> next();
+
+    [[nodiscard]] size_t tokensProduced() const { return m_produced; }
 
 private:
-    [[nodiscard]] inline std::optional<char> peak(int ahead = 0) const {
-        if (m_index + ahead >= m_input.length()) return {};
-        return m_input.at(m_index + ahead);
-    }
-    
-    inline char consume() {
-        char currentChar = m_input.at(m_index++);
-        if (currentChar == '\n') {
-            m_line++;
-            m_col = 1;
-        } else {
-            m_col++;
-        }
-        return currentChar;
+    inline std::optional<Token> lex();
+    inline Token lexNumber(size_t start);
+    // Recebem o byte logo apos o abridor e devolvem o byte seguinte ao terminador,
+    // ou nullptr se o comentario nao fecha antes de 'fim'.
+    inline const char* skipBraceComment(const char* p, const char* fim) const;
+    inline const char* skipParenComment(const char* p, const char* fim) const;
+
+    // Sem verificacao de limites: depois do fim ha sempre o preenchimento com NUL.
+    [[nodiscard]] inline char ahead(size_t k) const { return m_input.data()[m_index + k]; }
+
+    // Chamado quando um comentario ou string iniciado em 'start' chega ao fim do trecho.
+    // Se o trecho nao e o fim do arquivo, a construcao continua no proximo trecho.
+    inline bool stopAtPending(size_t start) {
+        if (m_end >= m_input.size()) return false;
+        m_pending = start;
+        m_index = m_end;
+        return true;
+    }
+
+    [[nodiscard]] inline uint32_t location(size_t i) const { return m_base + static_cast<uint32_t>(i); }
+
+    [[nodiscard]] inline size_t scanned(const char* p) const { return static_cast<size_t>(p - m_input.data()); }
+
+    [[nodiscard]] inline Token make(Tipo_de_token type, size_t start) {
+        m_produced++;
+        return {type, m_base + static_cast<uint32_t>(start), static_cast<uint32_t>(m_index - start)};
     }
 
-    const std::string m_input;
+    const std::string_view m_input;
+    Interner& m_symbols;
+    DiagnosticEngine* m_diagnostics;
     size_t m_index;
-    int m_line;
-    int m_col;
+    size_t m_end;
+    std::optional<size_t> m_pending;
+    bool m_nested = false;
+    uint32_t m_base = 0;
+
+    std::array<Token, LOOKAHEAD> m_ring {};
+    size_t m_head = 0;
+    size_t m_count = 0;
+    size_t m_produced = 0;
 };
 
+inline const Token* Tokenizer::peek(size_t k) {
+    if (k >= LOOKAHEAD) throw std::logic_error("Tokenizer::peek alem da janela de lookahead.");
+    while (m_count <= k) {
+        std::optional<Token> t = lex();
+        if (!t) return nullptr;
+        m_ring[(m_head + m_count) % LOOKAHEAD] = *t;
+        m_count++;
+    }
+    return &m_ring[(m_head + k) % LOOKAHEAD];
+}
+
+inline std::optional<Token> Tokenizer::next() {
+    if (!peek()) return {};
+    Token t = m_ring[m_head];
+    m_head = (m_head + 1) % LOOKAHEAD;
+    m_count--;
+    return t;
+}
+
 inline std::vector<Token> Tokenizer::tokenize() {
     std::vector<Token> tokens;
-    const std::unordered_map<std::string, Tipo_de_token> keywords = {
-        {"program", Tipo_de_token::PROGRAM}, {"var", Tipo_de_token::VAR}, {"const", Tipo_de_token::CONST},
-        {"procedure", Tipo_de_token::PROCEDURE}, {"function", Tipo_de_token::FUNCTION}, {"label", Tipo_de_token::LABEL},
-        {"begin", Tipo_de_token::BEGIN}, {"end", Tipo_de_token::END}, {"if", Tipo_de_token::IF}, {"then", Tipo_de_token::THEN},
-        {"else", Tipo_de_token::ELSE}, {"while", Tipo_de_token::WHILE}, {"do", Tipo_de_token::DO}, {"for", Tipo_de_token::FOR},
-        {"to", Tipo_de_token::TO}, {"downto", Tipo_de_token::DOWNTO}, {"repeat", Tipo_de_token::REPEAT}, {"until", Tipo_de_token::UNTIL},
-        {"integer", Tipo_de_token::INTEGER}, {"real", Tipo_de_token::REAL}, {"boolean", Tipo_de_token::BOOLEAN},
-        {"string", Tipo_de_token::STRING}, {"true", Tipo_de_token::BOOL_LIT}, {"false", Tipo_de_token::BOOL_LIT},
-        {"div", Tipo_de_token::DIV}, {"and", Tipo_de_token::AND}, {"or", Tipo_de_token::OR}, {"not", Tipo_de_token::NOT}
-    };
+    for (; m_count > 0; m_count--, m_head = (m_head + 1) % LOOKAHEAD) tokens.push_back(m_ring[m_head]);
+    while (std::optional<Token> t = lex()) tokens.push_back(*t);
+    return tokens;
+}
 
-    while (m_index < m_input.length()) {
+inline TokenStream Tokenizer::tokenizeStream() {
+    TokenStream tokens;
+    for (; m_count > 0; m_count--, m_head = (m_head + 1) % LOOKAHEAD) tokens.push(m_ring[m_head]);
+    while (std::optional<Token> t = lex()) tokens.push(*t);
+    return tokens;
+}
+
+// O primeiro byte de cada token escolhe o estado do automato pela tabela
+// chars::ACOES; os estados de varredura longa usam as rotinas de scan::.
+inline std::optional<Token> Tokenizer::lex() {
+    const char* fim = m_input.data() + m_end;
+    while (m_index < m_end) {
         char current_char = m_input[m_index];
-        int start_col = m_col;
+        size_t start = m_index;
 
-        if (std::isspace(current_char)) { consume(); continue; }
+        switch (chars::action(current_char)) {
+        case chars::Acao::ESPACO:
+            m_index = scanned(scan::skipWhitespace(m_input.data() + m_index));
+            continue;
 
-        if (current_char == '{') {
-            consume();
-            while (peak().has_value() && peak().value() != '}') { consume(); }
-            if(peak().has_value()) consume(); // Consome o '}'
+        case chars::Acao::COMENTARIO: {
+            const char* depois = skipBraceComment(m_input.data() + m_index + 1, fim);
+            if (!depois && stopAtPending(start)) return {};
+            m_index = depois ? scanned(depois) : m_end;
             continue;
         }
 
-        if (std::isalpha(current_char) || current_char == '_') {
-            std::string buf; buf += consume();
-            while (peak().has_value() && (std::isalnum(peak().value()) || peak().value() == '_')) { buf += consume(); }
-            if (keywords.count(buf)) {
-                tokens.push_back({keywords.at(buf), buf, m_line, start_col});
+        case chars::Acao::IDENTIFICADOR: {
+            m_index = scanned(scan::skipIdentifier(m_input.data() + m_index + 1));
+            std::string_view buf = m_input.substr(start, m_index - start);
+            Tipo_de_token tipo = lookupKeyword(buf);
+            Token t = make(tipo, start);
+            if (tipo == Tipo_de_token::IDENTIFIER) t.payload = m_symbols.intern(buf);
+            return t;
+        }
+
+        case chars::Acao::NUMERO:
+            return lexNumber(start);
+
+        case chars::Acao::HEXADECIMAL:
+            if (chars::isHexDigit(ahead(1))) return lexNumber(start);
+            break;
+
+        case chars::Acao::STRING: {
+            const char* aspa = scan::findByte(m_input.data() + m_index + 1, fim, '\'');
+            if (aspa == fim && stopAtPending(start)) return {};
+            if (aspa < fim) {
+                m_index = scanned(aspa) + 1; // Consome a aspa final
             } else {
-                tokens.push_back({Tipo_de_token::IDENTIFIER, buf, m_line, start_col});
+                m_index = m_end;
+                m_diagnostics->report(DiagCode::UNTERMINATED_STRING, location(m_index));
             }
-            continue;
+            return make(Tipo_de_token::STRING_LIT, start);
         }
 
-        if (std::isdigit(current_char)) {
-            std::string buf; buf += consume();
-            bool is_real = false;
-            while (peak().has_value() && (std::isdigit(peak().value()) || (peak().value() == '.' && !is_real))) {
-                if (peak().value() == '.') is_real = true;
-                buf += consume();
+        case chars::Acao::COMENTARIO_OU_OPERADOR:
+            if (current_char == '(' && ahead(1) == '*') {
+                const char* depois = skipParenComment(m_input.data() + m_index + 2, fim);
+                if (!depois && stopAtPending(start)) return {};
+                m_index = depois ? scanned(depois) : m_end;
+                continue;
             }
-            tokens.push_back({is_real ? Tipo_de_token::REAL_LIT : Tipo_de_token::INT_LIT, buf, m_line, start_col});
-            continue;
+            if (current_char == '/' && ahead(1) == '/') {
+                // Vai ate o '\n', que sempre fica dentro do trecho (os trechos terminam em '\n')
+                m_index = scanned(scan::findByte(m_input.data() + m_index + 2, fim, '\n'));
+                continue;
+            }
+            [[fallthrough]];
+
+        case chars::Acao::OPERADOR: {
+            const operators::Entry& op = operators::TABLE[static_cast<unsigned char>(current_char)];
+            m_index++;
+            // No fim do texto o proximo byte e o sentinela, que nao continua nenhum operador
+            for (uint8_t k = 0; k < op.continuacoes; k++) {
+                if (ahead(0) == op.segundo[k]) { m_index++; return make(op.composto[k], start); }
+            }
+            return make(op.simples, start);
         }
 
-        if (current_char == '\'') {
-            consume();
-            std::string buf;
-            while (peak().has_value() && peak().value() != '\'') { buf += consume(); }
-            if (peak().has_value()) consume(); 
-            else std::cerr << "Erro lexico: String nao terminada na linha " << m_line << std::endl;
-            tokens.push_back({Tipo_de_token::STRING_LIT, buf, m_line, start_col});
+        case chars::Acao::UTF8: {
+            // Relata o caractere inteiro, nao apenas o primeiro byte da sequencia
+            size_t n = 1;
+            const size_t esperado = utf8::sequenceLength(static_cast<unsigned char>(current_char));
+            while (n < esperado && utf8::isContinuation(static_cast<unsigned char>(ahead(n)))) n++;
+            m_diagnostics->report(DiagCode::UNEXPECTED_CHAR, location(m_index), {m_input.substr(m_index, n)});
+            m_index += n;
             continue;
         }
 
-        // Simbolos
-        if (current_char == ':' && peak(1) == '=') { tokens.push_back({Tipo_de_token::ASSIGN, ":=", m_line, start_col}); consume(); consume(); }
-        else if (current_char == '<' && peak(1) == '>') { tokens.push_back({Tipo_de_token::NOT_EQUAL, "<>", m_line, start_col}); consume(); consume(); }
-        else if (current_char == '<' && peak(1) == '=') { tokens.push_back({Tipo_de_token::LESS_EQUAL, "<=", m_line, start_col}); consume(); consume(); }
-        else if (current_char == '>' && peak(1) == '=') { tokens.push_back({Tipo_de_token::GREATER_EQUAL, ">=", m_line, start_col}); consume(); consume(); }
-        else {
-             switch(current_char) {
-                case '+': tokens.push_back({Tipo_de_token::PLUS, "+", m_line, start_col}); consume(); break;
-                case '-': tokens.push_back({Tipo_de_token::MINUS, "-", m_line, start_col}); consume(); break;
-                case '*': tokens.push_back({Tipo_de_token::MULTIPLY, "*", m_line, start_col}); consume(); break;
-                case '/': tokens.push_back({Tipo_de_token::DIVIDE, "/", m_line, start_col}); consume(); break;
-                case '=': tokens.push_back({Tipo_de_token::EQUAL, "=", m_line, start_col}); consume(); break;
-                case '<': tokens.push_back({Tipo_de_token::LESS, "<", m_line, start_col}); consume(); break;
-                case '>': tokens.push_back({Tipo_de_token::GREATER, ">", m_line, start_col}); consume(); break;
-                case '(': tokens.push_back({Tipo_de_token::OPEN_PAREN, "(", m_line, start_col}); consume(); break;
-                case ')': tokens.push_back({Tipo_de_token::CLOSE_PAREN, ")", m_line, start_col}); consume(); break;
-                case ';': tokens.push_back({Tipo_de_token::SEMICOLON, ";", m_line, start_col}); consume(); break;
-                case ':': tokens.push_back({Tipo_de_token::COLON, ":", m_line, start_col}); consume(); break;
-                case '.': tokens.push_back({Tipo_de_token::DOT, ".", m_line, start_col}); consume(); break;
-                case ',': tokens.push_back({Tipo_de_token::COMMA, ",", m_line, start_col}); consume(); break;
-                default: std::cerr << "Erro lexico: Caractere inesperado '" << current_char << "' na linha " << m_line << std::endl; consume(); break;
-            }
+        case chars::Acao::INVALIDO:
+            break;
         }
+
+        if (static_cast<unsigned char>(current_char) < 0x80) {
+            m_diagnostics->report(DiagCode::UNEXPECTED_CHAR, location(m_index), {std::string_view(&current_char, 1)});
+        } else {
+            // Byte que nao forma UTF-8 valido: mostrado em hexadecimal para nao corromper a saida
+            static constexpr char HEX[] = "0123456789ABCDEF";
+            const unsigned char c = static_cast<unsigned char>(current_char);
+            const char texto[4] = {'\\', 'x', HEX[c >> 4], HEX[c & 0xF]};
+            m_diagnostics->report(DiagCode::UNEXPECTED_CHAR, location(m_index), {std::string_view(texto, 4)});
+        }
+        m_index++;
     }
-    return tokens;
+    return {};
+}
+
+inline std::optional<size_t> Tokenizer::constructEnd(size_t inicio) const {
+    const char* p = m_input.data() + inicio;
+    const char* fim = m_input.data() + m_input.size();
+    const char* depois = nullptr;
+    if (*p == '{') {
+        depois = skipBraceComment(p + 1, fim);
+    } else if (*p == '(') {
+        depois = skipParenComment(p + 2, fim);
+    } else {
+        const char* aspa = scan::findByte(p + 1, fim, '\'');
+        if (aspa < fim) depois = aspa + 1;
+    }
+    if (!depois) return std::nullopt;
+    return scanned(depois);
+}
+
+inline const char* Tokenizer::skipBraceComment(const char* p, const char* fim) const {
+    if (!m_nested) {
+        const char* fecha = scan::findByte(p, fim, '}');
+        return fecha < fim ? fecha + 1 : nullptr;
+    }
+    for (size_t nivel = 1;;) {
+        p = scan::findEither(p, fim, '{', '}');
+        if (p == fim) return nullptr;
+        if (*p++ == '{') nivel++;
+        else if (--nivel == 0) return p;
+    }
+}
+
+// O '*' de "(*" nao pode fechar o proprio comentario: "(*)" ainda esta aberto.
+// p[1] pode ser lido mesmo em p == fim - 1 gracas ao preenchimento do buffer.
+inline const char* Tokenizer::skipParenComment(const char* p, const char* fim) const {
+    for (size_t nivel = 1;;) {
+        p = m_nested ? scan::findEither(p, fim, '(', '*') : scan::findByte(p, fim, '*');
+        if (p == fim) return nullptr;
+        if (p[0] == '*' && p[1] == ')') {
+            p += 2;
+            if (--nivel == 0) return p;
+        } else if (p[0] == '(' && p[1] == '*') {
+            p += 2;
+            nivel++;
+        } else {
+            p++;
+        }
+    }
+}
+
+// Literais numericos: decimal (123), hexadecimal ($FF), real com fracao e/ou
+// expoente (1.5, 2e10, 1.5E-3). O valor e convertido aqui com std::from_chars e
+// guardado no payload; constantes fora do intervalo geram erro lexico.
+// Os lacos param no sentinela NUL; num trecho do lexico paralelo o numero
+// tambem nao passa do '\n' que encerra o trecho.
+inline Token Tokenizer::lexNumber(size_t start) {
+    const char* inicio = m_input.data() + start;
+    auto digitos = [](const char* p) {
+        while (chars::isDigit(*p)) p++;
+        return p;
+    };
+
+    if (*inicio == '$') {
+        const char* p = inicio + 1;
+        while (chars::isHexDigit(*p)) p++;
+        m_index = scanned(p);
+        Token t = make(Tipo_de_token::INT_LIT, start);
+        int64_t valor = 0;
+        if (std::from_chars(inicio + 1, p, valor, 16).ec == std::errc::result_out_of_range) {
+            m_diagnostics->report(DiagCode::INT_OUT_OF_RANGE, t.offset, {std::string_view(inicio, p - inicio)});
+        }
+        t.payload = static_cast<uint64_t>(valor);
+        return t;
+    }
+
+    const char* p = digitos(inicio);
+    bool is_real = false;
+    // '.' so inicia a fracao se vier seguido de digito ("1..10" e um intervalo)
+    if (*p == '.' && chars::isDigit(p[1])) {
+        is_real = true;
+        p = digitos(p + 1);
+    }
+    if (*p == 'e' || *p == 'E') {
+        const char* e = p + 1;
+        if (*e == '+' || *e == '-') e++;
+        if (chars::isDigit(*e)) {
+            is_real = true;
+            p = digitos(e);
+        }
+    }
+    m_index = scanned(p);
+
+    Token t = make(is_real ? Tipo_de_token::REAL_LIT : Tipo_de_token::INT_LIT, start);
+    if (is_real) {
+        double valor = 0;
+        if (std::from_chars(inicio, p, valor).ec == std::errc::result_out_of_range) {
+            m_diagnostics->report(DiagCode::REAL_OUT_OF_RANGE, t.offset, {std::string_view(inicio, p - inicio)});
+        }
+        t.setRealValue(valor);
+    } else {
+        int64_t valor = 0;
+        if (std::from_chars(inicio, p, valor).ec == std::errc::result_out_of_range) {
+            m_diagnostics->report(DiagCode::INT_OUT_OF_RANGE, t.offset, {std::string_view(inicio, p - inicio)});
+        }
+        t.payload = static_cast<uint64_t>(valor);
+    }
+    return t;
 }
\ No newline at end of file
@@ -0,0 +1,67 @@
+#ifndef UTF8_HPP
+#define UTF8_HPP
+
+#include <cstddef>
+#include <optional>
+#include <string_view>
+
+#include "scan_kernels.hpp"
+
+// Suporte a fontes em UTF-8. Fora de strings e comentarios a linguagem so usa
+// ASCII; os bytes >= 0x80 so precisam formar sequencias validas.
+namespace utf8 {
+
+constexpr std::string_view BOM = "\xEF\xBB\xBF";
+
+// Tamanho da sequencia pelo byte inicial; 0 se o byte nao pode iniciar uma
+// sequencia (continuacao, inicio de forma longa demais ou acima de U+10FFFF).
+constexpr size_t sequenceLength(unsigned char c) {
+    if (c < 0x80) return 1;
+    if (c < 0xC2) return 0;
+    if (c < 0xE0) return 2;
+    if (c < 0xF0) return 3;
+    if (c < 0xF5) return 4;
+    return 0;
+}
+
+constexpr bool isContinuation(unsigned char c) { return (c & 0xC0) == 0x80; }
+
+// Offset do primeiro byte que nao inicia uma sequencia UTF-8 valida, ou nullopt.
+// Os trechos ASCII sao pulados pelas rotinas SIMD de scan::; so as sequencias
+// multibyte sao verificadas byte a byte (formas longas demais, surrogates e
+// valores acima de U+10FFFF sao rejeitados).
+inline std::optional<size_t> firstInvalid(std::string_view texto) {
+    const char* inicio = texto.data();
+    const char* fim = inicio + texto.size();
+    const char* p = inicio;
+    while ((p = scan::findNonAscii(p, fim)) < fim) {
+        const unsigned char c = static_cast<unsigned char>(p[0]);
+        const size_t n = sequenceLength(c);
+        if (n == 0 || static_cast<size_t>(fim - p) < n) return static_cast<size_t>(p - inicio);
+
+        // O segundo byte tem faixa propria depois de E0, ED, F0 e F4
+        const unsigned char c1 = static_cast<unsigned char>(p[1]);
+        unsigned char menor = 0x80, maior = 0xBF;
+        if (c == 0xE0) menor = 0xA0;
+        else if (c == 0xED) maior = 0x9F;
+        else if (c == 0xF0) menor = 0x90;
+        else if (c == 0xF4) maior = 0x8F;
+        if (c1 < menor || c1 > maior) return static_cast<size_t>(p - inicio);
+        for (size_t k = 2; k < n; k++) {
+            if (!isContinuation(static_cast<unsigned char>(p[k]))) return static_cast<size_t>(p - inicio);
+        }
+        p += n;
+    }
+    return {};
+}
+
+// Numero de code points em [p, p + n)
+inline size_t countCodePoints(const char* p, size_t n) {
+    size_t total = 0;
+    for (size_t i = 0; i < n; i++) total += !isContinuation(static_cast<unsigned char>(p[i]));
+    return total;
+}
+
+} // namespace utf8
+
+#endif
@@ -0,0 +1,85 @@
+# Regressao para expressoes longas e aninhamento profundo (cmake -P).
+#
+#   -DCOMPILER=<executavel> -DWORK_DIR=<diretorio para os fontes gerados>
+#
+# Cada fonte e compilado em todos os modos do parser e da analise semantica.
+# O compilador deve terminar normalmente (status 0, sem sinal) e emitir
+# 'aninhamento-excessivo' somente nos casos acima de Parser::MAX_NESTING.
+
+if(NOT COMPILER OR NOT WORK_DIR)
+    message(FATAL_ERROR "Uso: cmake -DCOMPILER=... -DWORK_DIR=... -P aninhamento.cmake")
+endif()
+file(MAKE_DIRECTORY "${WORK_DIR}")
+
+# saida = texto repetido n vezes (por duplicacao; string(REPEAT) exige CMake 3.15)
+function(repetir saida texto n)
+    set(resultado "")
+    set(bloco "${texto}")
+    while(n GREATER 0)
+        math(EXPR bit "${n} % 2")
+        if(bit)
+            string(APPEND resultado "${bloco}")
+        endif()
+        math(EXPR n "${n} / 2")
+        if(n GREATER 0)
+            string(APPEND bloco "${bloco}")
+        endif()
+    endwhile()
+    set(${saida} "${resultado}" PARENT_SCOPE)
+endfunction()
+
+set(CABECALHO "program P;\nvar x: integer;\nbegin\n")
+
+# Cadeia de 1M termos: lida pelo laco Pratt, nao conta como aninhamento
+repetir(termos "+1" 1000000)
+file(WRITE "${WORK_DIR}/cadeia.pas" "${CABECALHO}x := 1${termos};\nend.\n")
+
+# Sinal e parenteses aninhados abaixo e acima do limite
+repetir(abre "-(" 400)
+repetir(fecha ")" 400)
+file(WRITE "${WORK_DIR}/unario_raso.pas" "${CABECALHO}x := ${abre}1${fecha};\nend.\n")
+repetir(abre "-(" 5000)
+repetir(fecha ")" 5000)
+file(WRITE "${WORK_DIR}/unario_fundo.pas" "${CABECALHO}x := ${abre}1${fecha};\nend.\n")
+
+# Cadeia 'else if' de 3000 ramos: lida por um laco, nao conta como aninhamento
+repetir(ramos "if x = 1 then x := 2; else " 3000)
+file(WRITE "${WORK_DIR}/senao_se.pas" "${CABECALHO}${ramos}x := 0;\nend.\n")
+
+# Limite atingido exatamente no fim do arquivo (sem token para a posicao do erro)
+repetir(blocos "begin " 1999)
+file(WRITE "${WORK_DIR}/fim_aninhado.pas" "${CABECALHO}${blocos}x :=")
+
+set(MODOS "padrao" "--lote" "--ast-plana" "--passagem-unica" "--paralelo")
+
+# esperado: TRUE se o diagnostico aninhamento-excessivo deve aparecer
+function(verificar nome esperado)
+    foreach(modo IN LISTS MODOS)
+        set(opcoes --diagnosticos=json)
+        if(NOT modo STREQUAL "padrao")
+            list(APPEND opcoes ${modo})
+        endif()
+        execute_process(COMMAND "${COMPILER}" ${opcoes} "${WORK_DIR}/${nome}.pas"
+                        RESULT_VARIABLE status OUTPUT_QUIET ERROR_VARIABLE erros)
+        string(FIND "${erros}" "\"aninhamento-excessivo\"" achou)
+        string(FIND "${erros}" "\"codigo\"" algum)
+        set(problema "")
+        if(NOT status STREQUAL "0")
+            set(problema "status ${status}")
+        elseif(esperado AND achou EQUAL -1)
+            set(problema "aninhamento-excessivo nao foi emitido")
+        elseif(NOT esperado AND NOT algum EQUAL -1)
+            set(problema "diagnosticos inesperados")
+        endif()
+        if(problema)
+            string(SUBSTRING "${erros}" 0 300 inicio)
+            message(SEND_ERROR "${nome}.pas [${modo}]: ${problema}\n${inicio}")
+        endif()
+    endforeach()
+endfunction()
+
+verificar(cadeia FALSE)
+verificar(unario_raso FALSE)
+verificar(unario_fundo TRUE)
+verificar(senao_se FALSE)
+verificar(fim_aninhado TRUE)
@@ -0,0 +1,94 @@
+// Teste diferencial do IncrementalLexer: aplica edicoes aleatorias e, depois de
+// cada uma, compara os tokens mantidos incrementalmente com uma analise lexica
+// completa do texto resultante. As edicoes misturam pedacos que abrem e fecham
+// comentarios e strings, expoentes ('1e+5' le 3 bytes alem do '1', ver
+// LOOKAHEAD_BYTES) e operadores de dois caracteres, que sao os casos em que o
+// ponto de reinicio e a ressincronizacao com os tokens antigos podem errar.
+//
+//   incremental_lexer_test [edicoes] [semente]
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ascii_fold.hpp"
+#include "incremental_lexer.hpp"
+
+namespace {
+
+const char* const PROGRAMA =
+    "program teste;\n"
+    "var x, y: integer; r: real; s: string; b: boolean;\n"
+    "{ comentario com 'aspas' e begin end }\n"
+    "begin\n"
+    "  x := 10; y := x * 2 + 3 div 4; r := 1.5e+3 - 2.0E-1;\n"
+    "  (* outro comentario\n     em duas linhas *)\n"
+    "  s := 'texto com { chave e (* parenteses';\n"
+    "  if (x <= y) and not b then begin r := r / 2; end;\n"
+    "  while x <> 0 do begin x := x - 1; end; // fim de linha\n"
+    "  for x := 1 to 10 do begin y := y mod 3; end;\n"
+    "  b := x in [1, 2, 3];\n"
+    "end.\n";
+
+const char* const PEDACOS[] = {
+    "x", " ", "{", "}", "'", "1", "e", "E", "+", "-", ":", "=", "<", ">", "\n", "begin",
+    "1e+5", "2.5", "(*", "*)", "..", ".", "ab cd", "//", "/", "(", ")", "'s'", ":=", "{ }",
+};
+
+// Texto com o preenchimento de NULs que o Tokenizer exige apos o fim
+std::vector<Token> analiseCompleta(std::string_view texto, Interner& simbolos) {
+    std::string buffer(texto);
+    buffer.append(scan::PADDING, '\0');
+    SourceManager fontes;
+    fontes.addBuffer("<completo>", std::string_view(buffer.data(), texto.size()));
+    DiagnosticEngine diagnosticos(fontes);
+    Tokenizer tokenizer(std::string_view(buffer.data(), texto.size()), simbolos, diagnosticos);
+    return tokenizer.tokenize();
+}
+
+// Os IDs de simbolo diferem (o Interner incremental acumula nomes de todas as
+// versoes do texto), entao identificadores sao comparados pelo nome. O Interner
+// guarda a primeira grafia vista de cada nome, por isso sem diferenciar maiusculas.
+bool iguais(const Token& a, const Interner& simbolosA, const Token& b, const Interner& simbolosB) {
+    if (a.type != b.type || a.offset != b.offset || a.length != b.length) return false;
+    if (a.type == Tipo_de_token::IDENTIFIER) return fold::equals(simbolosA.name(a.symbol()), simbolosB.name(b.symbol()));
+    return a.payload == b.payload;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const long edicoes = argc > 1 ? std::strtol(argv[1], nullptr, 10) : 20000;
+    const unsigned semente = argc > 2 ? static_cast<unsigned>(std::strtoul(argv[2], nullptr, 10)) : 42;
+
+    std::mt19937 rng(semente);
+    IncrementalLexer incremental(PROGRAMA);
+    const size_t nPedacos = sizeof(PEDACOS) / sizeof(PEDACOS[0]);
+
+    for (long k = 0; k < edicoes; k++) {
+        const uint32_t tamanho = static_cast<uint32_t>(incremental.source().size());
+        TextEdit edicao;
+        edicao.offset = static_cast<uint32_t>(rng() % (tamanho + 1));
+        // As remocoes pequenas removem menos do que os pedacos inserem; as
+        // maiores, que deslocam varios tokens de uma vez, mantem o texto perto de 1 KB
+        const uint32_t maximo = tamanho > 1024 && rng() % 4 == 0 ? 24 : 4;
+        edicao.removed = std::min<uint32_t>(static_cast<uint32_t>(rng() % maximo), tamanho - edicao.offset);
+        edicao.inserted = PEDACOS[rng() % nPedacos];
+        incremental.apply(edicao);
+
+        Interner simbolos;
+        const std::vector<Token> esperado = analiseCompleta(incremental.source(), simbolos);
+        const std::vector<Token> obtido = incremental.tokens();
+        size_t i = 0;
+        while (i < esperado.size() && i < obtido.size() && iguais(esperado[i], simbolos, obtido[i], incremental.symbols())) i++;
+        if (i < esperado.size() || i < obtido.size()) {
+            std::printf("Divergencia na edicao %ld (offset %u, removidos %u, inseridos '%s'): token %zu de %zu/%zu\n",
+                        k, edicao.offset, edicao.removed, edicao.inserted.c_str(), i, esperado.size(), obtido.size());
+            return EXIT_FAILURE;
+        }
+    }
+    std::printf("%ld edicoes conferidas com a analise completa\n", edicoes);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,96 @@
+// Forma da arvore montada pelo laco Pratt do Parser: cada expressao e
+// analisada como valor de uma atribuicao e a arvore e impressa com todos os
+// parenteses, para comparar com o agrupamento esperado. Cobre o nivel dos
+// operadores, a associatividade a esquerda e o alcance do sinal e do not.
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "parser.hpp"
+
+namespace {
+
+struct Caso {
+    const char* expressao;
+    const char* arvore;
+};
+
+const Caso CASOS[] = {
+    {"a * -b div c", "((a * (-b)) div c)"},
+    {"-a * b", "((-a) * b)"},
+    {"-a + b", "((-a) + b)"},
+    {"a - -b * c", "(a - ((-b) * c))"},
+    {"+a mod b", "((+a) mod b)"},
+    {"-(a + b) * c", "((-(a + b)) * c)"},
+    {"- -a * b", "((-(-a)) * b)"},
+    {"not a and b", "((not a) and b)"},
+    {"a - b - c", "((a - b) - c)"},
+    {"a + b * c = d", "((a + (b * c)) = d)"},
+    {"a * b + c * d", "((a * b) + (c * d))"},
+};
+
+class Impressao {
+public:
+    Impressao(const SourceManager& fontes) : m_texto(fontes.text(0)), m_base(fontes.base(0)) {}
+
+    std::string operator()(const ExprNode* e) const {
+        switch (e->kind) {
+        case AstKind::LITERAL: return texto(static_cast<const LiteralNode*>(e)->value);
+        case AstKind::IDENTIFIER: return texto(static_cast<const IdentifierNode*>(e)->identifier);
+        case AstKind::UNARY_OP: {
+            const auto* u = static_cast<const UnaryOpNode*>(e);
+            const std::string op = texto(u->op);
+            return "(" + op + (op == "not" ? " " : "") + (*this)(u->operand) + ")";
+        }
+        case AstKind::BINARY_OP: {
+            const auto* b = static_cast<const BinaryOpNode*>(e);
+            return "(" + (*this)(b->left) + " " + texto(b->op) + " " + (*this)(b->right) + ")";
+        }
+        default: return "?";
+        }
+    }
+
+private:
+    std::string texto(const Token& t) const { return std::string(m_texto.substr(t.offset - m_base, t.length)); }
+
+    std::string_view m_texto;
+    uint32_t m_base;
+};
+
+// Arvore do valor da atribuicao 'x := <expressao>;', ou a mensagem do problema
+std::string arvore(const char* expressao) {
+    std::string buffer = std::string("program P;\nbegin\nx := ") + expressao + ";\nend.\n";
+    const size_t tamanho = buffer.size();
+    buffer.append(scan::PADDING, '\0');
+    SourceManager fontes;
+    fontes.addBuffer("<caso>", std::string_view(buffer.data(), tamanho));
+    DiagnosticEngine diagnosticos(fontes);
+    Interner simbolos;
+    Tokenizer tokenizer(std::string_view(buffer.data(), tamanho), simbolos, diagnosticos);
+    const std::vector<Token> tokens = tokenizer.tokenize();
+
+    AstArena arena;
+    Parser parser(tokens, diagnosticos, AstBuilder(arena));
+    const ProgramNode* programa = parser.parseProgram();
+    if (!programa) return "erro sintatico";
+    const auto* bloco = static_cast<const BlockNode*>(programa->mainBlock);
+    if (bloco->statements.size() != 1 || bloco->statements[0]->kind != AstKind::ASSIGN) return "atribuicao nao encontrada";
+    return Impressao(fontes)(static_cast<const AssignNode*>(bloco->statements[0])->value);
+}
+
+} // namespace
+
+int main() {
+    int falhas = 0;
+    for (const Caso& c : CASOS) {
+        const std::string obtido = arvore(c.expressao);
+        if (obtido != c.arvore) {
+            std::printf("%s: esperado %s, obtido %s\n", c.expressao, c.arvore, obtido.c_str());
+            falhas++;
+        }
+    }
+    const size_t total = sizeof(CASOS) / sizeof(CASOS[0]);
+    std::printf("%zu de %zu expressoes com a arvore esperada\n", total - falhas, total);
+    return falhas ? EXIT_FAILURE : EXIT_SUCCESS;
+}